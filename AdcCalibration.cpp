@@ -0,0 +1,150 @@
+// Do not remove the include below
+#include "AdcCalibration.h"
+
+#include <EEPROM.h>
+#include "consts_and_types.h"
+
+/**
+ * Default points in mV, measured per channel at 0, 1, 2, 3, 4 and 4.25 V
+ * input. See ADC-calibration.ods. Above about 4.3 V the input saturates.
+ */
+static const uint16_t DEFAULT_RAW[AdcCalibration::CHANNELS][AdcCalibration::POINTS] = {
+		{ 8, 201, 396, 596, 796, 844 },
+		{ 8, 202, 401, 593, 795, 844 },
+		{ 9, 199, 397, 596, 795, 843 },
+		{ 8, 201, 400, 592, 795, 843 } };
+static const uint16_t DEFAULT_MV[AdcCalibration::POINTS] = {
+		0, 1000, 2000, 3000, 4000, 4250 };
+
+/**
+ * Load points from EEPROM and precompute the knot tables. If EEPROM holds no
+ * calibration the defaults are saved. Call EEPROM.begin() first!
+ */
+void AdcCalibration::load() {
+	EEPROM.get(EEPROM_CAL_POS, store);
+
+	if (store.magic != MAGIC) {
+		store.magic = MAGIC;
+		for (byte c = 0; c < CHANNELS; c++) {
+			for (byte k = 0; k < POINTS; k++) {
+				store.points[c][k].raw = DEFAULT_RAW[c][k];
+				store.points[c][k].val = DEFAULT_MV[k];
+			}
+		}
+		save();
+	}
+
+	for (byte c = 0; c < CHANNELS; c++) {
+		build(c);
+	}
+}
+
+/**
+ * Set or clear a calibration point packed as described in the class comment
+ * and save it to EEPROM. Returns false if channel or point is out of range.
+ */
+bool AdcCalibration::setPoint(unsigned long packed) {
+	byte channel = (packed >> 30) & 0x03;
+	byte point = (packed >> 27) & 0x07;
+	bool clear = (packed >> 26) & 0x01;
+
+	if (point >= POINTS) {
+		return false;
+	}
+
+	Point * const p = &store.points[channel][point];
+	p->raw = clear ? NO_POINT : (packed >> 16) & 0x3FF;
+	p->val = packed & 0xFFFF;
+
+	save();
+	build(channel);
+	return true;
+}
+
+/**
+ * Returns the calibrated value of a raw count on channel 0..3.
+ */
+unsigned int AdcCalibration::convert(byte channel, unsigned int raw) const {
+	return convertFine(channel, (unsigned long) raw << ANALOG::FRACTION_BITS);
+}
+
+/**
+ * Returns the calibrated value on channel 0..3 of a count with
+ * ANALOG::FRACTION_BITS fraction bits, see AdcFilter::read().
+ */
+unsigned int AdcCalibration::convertFine(byte channel, unsigned long fine) const {
+	const byte shift = 16 + ANALOG::FRACTION_BITS;
+	const Segment * seg;
+	unsigned long start;
+	byte j;
+
+	if (channel >= CHANNELS) {
+		return 0;
+	}
+	if (used[channel] < 2) {
+		return (fine + (1 << (ANALOG::FRACTION_BITS - 1)))
+				>> ANALOG::FRACTION_BITS;
+	}
+
+	seg = segments[channel];
+	if (fine <= (unsigned long) seg[0].raw << ANALOG::FRACTION_BITS) {
+		return seg[0].val;
+	}
+
+	j = used[channel] - 1;
+	while (fine < (unsigned long) seg[j].raw << ANALOG::FRACTION_BITS) {
+		--j;
+	}
+	start = (unsigned long) seg[j].raw << ANALOG::FRACTION_BITS;
+
+	return seg[j].val
+			+ (((int64_t) (fine - start) * seg[j].slope
+					+ (1L << (shift - 1))) >> shift);
+}
+
+/***************
+ * Private
+ ***************/
+
+/**
+ * Save points to EEPROM.
+ */
+void AdcCalibration::save() {
+	EEPROM.put(EEPROM_CAL_POS, store);
+	EEPROM.commit();	// Commit writes
+}
+
+/**
+ * Precompute segments for channel from its points. With less than two points
+ * the raw count is passed through.
+ */
+void AdcCalibration::build(byte channel) {
+	Segment * const seg = segments[channel];
+	byte n = 0;
+	byte j;
+
+	// Insertion sort the used points by raw count
+	for (byte k = 0; k < POINTS; k++) {
+		Point p = store.points[channel][k];
+		if (p.raw == NO_POINT) {
+			continue;
+		}
+		j = n++;
+		while (j > 0 && seg[j - 1].raw > p.raw) {
+			seg[j] = seg[j - 1];
+			--j;
+		}
+		seg[j].raw = p.raw;
+		seg[j].val = p.val;
+	}
+	used[channel] = n;
+
+	for (j = 0; j < n; j++) {
+		if (j + 1 < n && seg[j + 1].raw > seg[j].raw) {
+			seg[j].slope = (((int64_t) seg[j + 1].val - seg[j].val) * 65536)
+					/ (seg[j + 1].raw - seg[j].raw);
+		} else {
+			seg[j].slope = 0;
+		}
+	}
+}
@@ -0,0 +1,66 @@
+#ifndef AdcCalibration_H_
+#define AdcCalibration_H_
+
+#include "Arduino.h"
+
+/**
+ * Piecewise linear conversion of raw ADC counts to engineering units (mV by
+ * default) for the four multiplexed channels.
+ *
+ * Each channel has up to POINTS calibration points (raw, value) kept in EEPROM
+ * at EEPROM_CAL_POS. From the points a table of segments with start point and
+ * slope in 16 bit fixed point is precomputed, so a conversion is a search of
+ * at most POINTS segments and one multiply. Calibration points convert
+ * exactly. Values are clamped to the end points outside the calibrated range.
+ * Filtered values with ANALOG::FRACTION_BITS fraction bits convert with their
+ * full resolution.
+ *
+ * Points are set through parameter PRM::ADC_CAL packed as
+ * - bit 31-30; Channel 0..3
+ * - bit 29-27; Point 0..5
+ * - bit 26;    1 to clear the point
+ * - bit 25-16; Raw count 0..1023
+ * - bit 15-0;  Value
+ */
+class AdcCalibration {
+public:
+	static const byte CHANNELS = 4;
+	static const byte POINTS = 6;
+
+	void load();
+
+	bool setPoint(unsigned long packed);
+
+	unsigned int convert(byte channel, unsigned int raw) const;
+
+	unsigned int convertFine(byte channel, unsigned long fine) const;
+
+private:
+	static const byte MAGIC = 0x5C;
+	static const unsigned int NO_POINT = 0xFFFF;
+
+	struct Point {
+		uint16_t raw;	// Raw count, NO_POINT if unused
+		uint16_t val;	// Engineering value
+	};
+
+	struct Store {
+		byte magic;
+		Point points[CHANNELS][POINTS];
+	} store;
+
+	struct Segment {
+		uint16_t raw;	// Raw count at start
+		uint16_t val;	// Value at start
+		int64_t slope;	// Value per count * 65536
+	};
+
+	Segment segments[CHANNELS][POINTS]; // Sorted by raw count
+	byte used[CHANNELS]; // Number of segments, the last has slope 0
+
+	void save();
+
+	void build(byte channel);
+};
+
+#endif
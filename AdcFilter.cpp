@@ -0,0 +1,107 @@
+// Do not remove the include below
+#include "AdcFilter.h"
+
+/**
+ * Read and filter the currently selected channel. The multiplexer must be
+ * enabled and set to channel before calling. Returns the filtered value in
+ * counts with ANALOG::FRACTION_BITS fraction bits, 0..ANALOG::FINE_MAX.
+ *
+ * @param channel Channel 0..3, selects the filter state.
+ */
+unsigned int AdcFilter::read(byte channel) {
+	byte bits;
+	long x;
+
+	if (channel >= CHANNELS) {
+		return 0;
+	}
+
+	bits = min(oversample->get(), 3UL);
+
+	settle(channel);
+
+	// Median sum of 4^n samples is counts with 2n fraction bits
+	x = medianBlock(bits) << (ANALOG::FRACTION_BITS - 2 * bits);
+
+	if (!primed[channel] || ema_shift->get() == 0) {
+		state[channel] = x;
+		primed[channel] = true;
+	} else {
+		state[channel] += (x - (long) state[channel]) >> ema_shift->get();
+	}
+
+	return min(state[channel], ANALOG::FINE_MAX);
+}
+
+/**
+ * Restart the moving average of a channel, the next read() returns the
+ * unsmoothed value. Use for reads which must not lag behind a changing input.
+ *
+ * @param channel Channel 0..3.
+ */
+void AdcFilter::reset(byte channel) {
+	if (channel < CHANNELS) {
+		primed[channel] = false;
+	}
+}
+
+/**
+ * Returns the longest measured settling time of all channels [us].
+ */
+unsigned long AdcFilter::maxSettleTime() const {
+	unsigned long t = 0;
+	for (byte k = 0; k < CHANNELS; k++) {
+		t = max(t, settle_us[k]);
+	}
+	return t;
+}
+
+/***************
+ * Private
+ ***************/
+
+/**
+ * Sample until two consecutive samples agree with the previous within
+ * SETTLE_TOLERANCE, at most SETTLE_MAX_US. Saves the time it took.
+ */
+void AdcFilter::settle(byte channel) {
+	unsigned long start = micros();
+	int prev;
+	int cur;
+	byte stable = 0;
+
+	prev = analogRead(A0);
+	while (stable < 2 && micros() - start < SETTLE_MAX_US) {
+		cur = analogRead(A0);
+		stable = (abs(cur - prev) <= SETTLE_TOLERANCE) ? stable + 1 : 0;
+		prev = cur;
+	}
+
+	settle_us[channel] = micros() - start;
+}
+
+/**
+ * Returns the median of BLOCKS sums of 4^bits samples each.
+ */
+unsigned long AdcFilter::medianBlock(byte bits) const {
+	unsigned long sums[BLOCKS];
+	unsigned long sum;
+	byte j;
+
+	for (byte b = 0; b < BLOCKS; b++) {
+		sum = 0;
+		for (unsigned int i = 0; i < (1U << (2 * bits)); i++) {
+			sum += analogRead(A0);
+		}
+
+		// Insertion sort
+		j = b;
+		while (j > 0 && sums[j - 1] > sum) {
+			sums[j] = sums[j - 1];
+			--j;
+		}
+		sums[j] = sum;
+	}
+
+	return sums[BLOCKS / 2];
+}
@@ -0,0 +1,58 @@
+#ifndef AdcFilter_H_
+#define AdcFilter_H_
+
+#include "Arduino.h"
+#include "consts_and_types.h"
+#include "Parameter.h"
+
+/**
+ * Filtering of the multiplexed analogue input A0.
+ *
+ * A read of a channel
+ * - waits until consecutive samples agree within SETTLE_TOLERANCE counts,
+ *   which measures the multiplexer settling time per channel,
+ * - takes 5 blocks of 4^n samples and keeps the median block sum to reject
+ *   spikes. Decimating the sum by 2^n gives n extra bits,
+ * - smooths the result with an exponential moving average of weight 2^-m.
+ *
+ * Oversampling bits n and EMA shift m are set by parameters. The filtered
+ * value is kept and returned as counts with ANALOG::FRACTION_BITS fraction
+ * bits, so the extra bits reach the calibration.
+ */
+class AdcFilter {
+public:
+	static const byte CHANNELS = 4;
+
+	Parameter const * const oversample;	// Extra bits n, 0..3
+	Parameter const * const ema_shift;	// EMA weight 2^-m, 0 is off
+	unsigned long settle_us[CHANNELS];	// Measured settling time [us]
+
+	/**
+	 * Constructor
+	 */
+	AdcFilter(const Parameter* const oversample_prm,
+			const Parameter* const ema_prm) :
+			oversample(oversample_prm), ema_shift(ema_prm), settle_us { }, //
+			state { }, primed { } {
+	}
+
+	unsigned int read(byte channel);
+
+	void reset(byte channel);
+
+	unsigned long maxSettleTime() const;
+
+private:
+	static const byte BLOCKS = 5;
+	static const byte SETTLE_TOLERANCE = 2;		// [counts]
+	static const unsigned int SETTLE_MAX_US = 10000;
+
+	unsigned long state[CHANNELS];	// Filtered value, 16 bit fixed point
+	bool primed[CHANNELS];			// State holds a value
+
+	void settle(byte channel);
+
+	unsigned long medianBlock(byte bits) const;
+};
+
+#endif
@@ -0,0 +1,71 @@
+// Do not remove the include below
+#include "Benchmark.h"
+
+#include "BufferStream.h"
+
+/**
+ * Run all benchmarks and print the results.
+ */
+void Benchmark::runAll() {
+	// Zone which is never requested to pump, only its idle path runs
+	ZoneOutputs idle_outputs;
+	Zone idle { ZONE::COUNT - 1 };
+	idle.pump.attach(&idle_outputs, &m->ontime);
+
+	// Set the refresh rate to its current value and get it
+	const unsigned long val = m->refresh.get();
+	const byte set_req[] = { PRM::REFRESH_RATE, (byte) (val >> 24),
+			(byte) (val >> 16), (byte) (val >> 8), (byte) val, PRM::NONE };
+	const byte get_req[] = { PRM::REFRESH_RATE, PRM::NONE };
+
+	bool reset_last_err;
+	uint64_t now = m->clock.update();
+	unsigned long sink = 0;
+
+	measure("pump_run", 1000, [&]() {
+		idle.pump.run(now, false, -1UL);
+	});
+
+	measure("parameter_set", 1000, [&]() {
+		m->ontime.set(m->ontime.get());
+	});
+
+	measure("parameter_get", 1000, [&]() {
+		sink += m->ontime.get();
+	});
+
+	// Every save changes the value, so each one is written to flash
+	const unsigned long ontime = m->ontime.get();
+	unsigned long saves = 0;
+	measure("parameter_eeprom_save", 20, [&]() {
+		m->ontime.set(ontime ^ (++saves & 1));
+		m->ontime.eepromSave();
+	});
+	m->ontime.set(ontime);
+	m->ontime.eepromSave();
+
+	measure("parameter_eeprom_load", 100, [&]() {
+		idle.flow_capacity.eepromLoad();
+	});
+
+	// Time the decoders alone, without serial log and pacing delay
+	m->quiet = true;
+	measure("parse_set_request", 1000, [&]() {
+		BufferStream stream(set_req, sizeof(set_req));
+		m->parseParamSetRequest(&stream);
+	});
+
+	measure("parse_get_request", 1000, [&]() {
+		BufferStream stream(get_req, sizeof(get_req));
+		m->parseParamGetRequest(&stream);
+	});
+	m->quiet = false;
+
+	measure("pack_upload", 20, [&]() {
+		m->refresh.upload = true;
+		m->packFlaggedParams(m->packet, sizeof(m->packet), &reset_last_err);
+	});
+
+	Serial.print("]\n");
+	(void) sink;
+}
@@ -0,0 +1,72 @@
+#ifndef Benchmark_H_
+#define Benchmark_H_
+
+#include "MachineState.h"
+
+/**
+ * Micro benchmarks of the core routines, run on the device from the serial
+ * command "bench". Results are printed to serial as a JSON array with one
+ * object per routine:
+ * - ns_per_op;   Mean time per call [ns]
+ * - flash_per_op; Mean bytes written to flash per call
+ *
+ * The parameter and parser benchmarks use the live machine state. They only
+ * set parameters to their current values, except the EEPROM save which
+ * alternates the saved ONTIME and restores it. The pump run uses a zone of
+ * its own which never starts a pump. Allocations and the machine run are
+ * measured on the host, see test/bench.cpp.
+ */
+class Benchmark {
+public:
+	/**
+	 * Constructor
+	 */
+	Benchmark(MachineState* const machine) :
+			m(machine), first(true) {
+	}
+
+	void runAll();
+
+private:
+	MachineState * const m;
+	bool first;	// No result printed yet
+
+	template<typename F>
+	void measure(const char * const name, const unsigned int iterations, F op);
+};
+
+/**
+ * Run op iterations times and print the result.
+ */
+template<typename F>
+void Benchmark::measure(const char * const name,
+		const unsigned int iterations, F op) {
+	uint64_t cycles = 0;
+	uint32_t start;
+	unsigned long flash;
+
+	flash = Parameter::flash_bytes;
+
+	for (unsigned int k = 0; k < iterations; k++) {
+		start = ESP.getCycleCount();
+		op();
+		cycles += (uint32_t) (ESP.getCycleCount() - start);
+		yield(); // Let the ESP8266 do its thing too
+	}
+
+	flash = Parameter::flash_bytes - flash;
+
+	Serial.print(first ? "\n[" : ",\n");
+	first = false;
+	Serial.print("{\"name\":\"");
+	Serial.print(name);
+	Serial.print("\",\"iterations\":");
+	Serial.print(iterations, DEC);
+	Serial.print(",\"ns_per_op\":");
+	Serial.print((unsigned long) (cycles * 1000 / ESP.getCpuFreqMHz() / iterations), DEC);
+	Serial.print(",\"flash_per_op\":");
+	Serial.print((float) flash / iterations, 2);
+	Serial.print("}");
+}
+
+#endif
@@ -0,0 +1,31 @@
+// Do not remove the include below
+#include "BufferStream.h"
+
+/**
+ * Returns number of bytes left to read.
+ */
+int BufferStream::available() {
+	return length - pos;
+}
+
+/**
+ * Returns next byte or -1 at end of buffer.
+ */
+int BufferStream::read() {
+	return (pos < length) ? data[pos++] : -1;
+}
+
+/**
+ * Returns next byte without consuming it or -1 at end of buffer.
+ */
+int BufferStream::peek() {
+	return (pos < length) ? data[pos] : -1;
+}
+
+/**
+ * Writes are not supported. Returns 0.
+ */
+size_t BufferStream::write(uint8_t b) {
+	(void) b;
+	return 0;
+}
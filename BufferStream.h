@@ -0,0 +1,35 @@
+#ifndef BufferStream_H_
+#define BufferStream_H_
+
+#include "Arduino.h"
+
+/**
+ * Read only Stream over a byte buffer, used to feed a received message to
+ * the same parsers as a network stream. Writes are discarded.
+ */
+class BufferStream: public Stream {
+private:
+	const byte * const data;
+	const size_t length;
+	size_t pos;
+
+public:
+	/**
+	 * Constructor. The buffer must outlive the stream.
+	 */
+	BufferStream(const byte * const buffer, const size_t len) :
+			data(buffer), length(len), pos(0) {
+		setTimeout(0);
+	}
+
+	int available() override;
+
+	int read() override;
+
+	int peek() override;
+
+	size_t write(uint8_t b) override;
+
+};
+
+#endif
@@ -0,0 +1,119 @@
+// Do not remove the include below
+#include "Clock.h"
+
+#include <time.h>
+
+/**
+ * Returns milliseconds since power on as a 64 bit value.
+ */
+uint64_t Clock::update() {
+	unsigned long ms = millis();
+	if (ms < last_ms) {
+		++wraps;
+	}
+	last_ms = ms;
+	return ((uint64_t) wraps << 32) | ms;
+}
+
+/**
+ * Set the wall clock.
+ *
+ * @param epoch_s Seconds since 1970-01-01 UTC.
+ */
+void Clock::set(unsigned long epoch_s) {
+	offset_ms = (uint64_t) epoch_s * 1000 - update();
+	is_synced = true;
+
+	if (trace != nullptr) {
+		byte payload[] = { (byte) (epoch_s >> 24), (byte) (epoch_s >> 16),
+				(byte) (epoch_s >> 8), (byte) epoch_s };
+		trace->record(TRC::CLOCK, payload, sizeof(payload));
+	}
+}
+
+/**
+ * Set the wall clock from an HTTP Date header like
+ * "Sun, 06 Nov 1994 08:49:37 GMT". Returns false if it could not be parsed.
+ */
+bool Clock::setFromHttpDate(const char * const date) {
+	static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+	char month[4];
+	int d;
+	int y;
+	int hh;
+	int mm;
+	int ss;
+	const char * m;
+
+	if (date == nullptr
+			|| sscanf(date, "%*3s, %d %3s %d %d:%d:%d", &d, month, &y, &hh, &mm,
+					&ss) != 6 || (m = strstr(months, month)) == nullptr) {
+		return false;
+	}
+
+	// Days from civil, see http://howardhinnant.github.io/date_algorithms.html
+	int mon = (m - months) / 3 + 1;
+	y -= mon <= 2;
+	long era = y / 400;
+	long yoe = y - era * 400;
+	long doy = (153 * (mon + (mon > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+	long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	long days = era * 146097 + doe - 719468;
+
+	set(days * 86400UL + hh * 3600UL + mm * 60UL + ss);
+	return true;
+}
+
+/**
+ * Take the time from SNTP if it has been received and differs from the wall
+ * clock. Start SNTP with configTime() first.
+ */
+void Clock::pollSntp() {
+	time_t t = time(nullptr);
+	if (t > 1500000000L && (!is_synced || (unsigned long) t != epoch())) {
+		set(t);
+	}
+}
+
+/**
+ * Returns true if the wall clock has been set.
+ */
+bool Clock::synced() const {
+	return is_synced;
+}
+
+/**
+ * Returns seconds since 1970-01-01 UTC, 0 if not synced.
+ */
+unsigned long Clock::epoch() {
+	return is_synced ? (update() + offset_ms) / 1000 : 0;
+}
+
+/**
+ * Returns local day number since 1970-01-01. If not synced, days since power
+ * on.
+ */
+unsigned long Clock::localDay() {
+	return localSeconds() / 86400;
+}
+
+/**
+ * Returns local minute of day 0..1439.
+ */
+unsigned int Clock::localMinute() {
+	return (localSeconds() % 86400) / 60;
+}
+
+/***************
+ * Private
+ ***************/
+
+/**
+ * Returns local seconds since 1970-01-01, or since power on if not synced.
+ */
+unsigned long Clock::localSeconds() {
+	if (!is_synced) {
+		return update() / 1000;
+	}
+	return epoch() + ((long) tz_offset->get() - 720) * 60;
+}
@@ -0,0 +1,56 @@
+#ifndef Clock_H_
+#define Clock_H_
+
+#include "Arduino.h"
+#include "Parameter.h"
+#include "TraceRecorder.h"
+
+/**
+ * Monotonic 64 bit millisecond time base and wall clock.
+ *
+ * update() extends millis() past its 49.7 day wrap and must be called at
+ * least once per wrap period, e.g. every program loop. The wall clock is set
+ * from SNTP, the server HTTP Date header or the TIME parameter. Until then
+ * synced() is false. Every change of the wall clock is recorded as TRC::CLOCK
+ * so a replay sees the same windows and budget days.
+ */
+class Clock {
+public:
+	Parameter const * const tz_offset;	// Minutes east of UTC plus 720
+
+	/**
+	 * Constructor
+	 */
+	Clock(const Parameter* const tz_offset_prm,
+			TraceRecorder* const trace_rec) :
+			tz_offset(tz_offset_prm), last_ms(0), wraps(0), offset_ms(0), //
+			is_synced(false), trace(trace_rec) {
+	}
+
+	uint64_t update();
+
+	void set(unsigned long epoch_s);
+
+	bool setFromHttpDate(const char * const date);
+
+	void pollSntp();
+
+	bool synced() const;
+
+	unsigned long epoch();
+
+	unsigned long localDay();
+
+	unsigned int localMinute();
+
+private:
+	unsigned long last_ms;	// millis() at last update
+	unsigned long wraps;	// Number of millis() wraps
+	uint64_t offset_ms;		// Unix time - monotonic time [ms]
+	bool is_synced;
+	TraceRecorder * const trace;	// Records clock changes, may be nullptr
+
+	unsigned long localSeconds();
+};
+
+#endif
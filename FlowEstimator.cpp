@@ -0,0 +1,24 @@
+// Do not remove the include below
+#include "FlowEstimator.h"
+
+/**
+ * Returns the flow [cc/min] refined by a measured run.
+ *
+ * @param flow Current flow estimate [cc/min].
+ * @param seconds Runtime of the pump [s].
+ * @param volume Measured delivered volume [cc].
+ */
+unsigned long FlowEstimator::update(unsigned long flow, unsigned long seconds,
+		unsigned long volume) {
+	float x = seconds / 60.0f;	// Runtime [min]
+	float q = flow;
+	float k = p * x / (FLOW::FORGET + x * p * x);
+
+	q += k * (volume - q * x);
+	p = (p - k * x * p) / FLOW::FORGET;
+	if (p > FLOW::P_START) {
+		p = FLOW::P_START;
+	}
+
+	return (q > 0) ? (unsigned long) (q + 0.5f) : 0;
+}
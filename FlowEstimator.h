@@ -0,0 +1,31 @@
+#ifndef FlowEstimator_H_
+#define FlowEstimator_H_
+
+#include "Arduino.h"
+#include "consts_and_types.h"
+
+/**
+ * Recursive least squares estimate of a pump flow rate from measured runs.
+ *
+ * The model is volume = flow * runtime. Each run refines the flow with a gain
+ * that shrinks as runs agree and grows again through the forgetting factor
+ * FLOW::FORGET, so a slowly clogging pump is followed. Only the estimate
+ * variance is kept here, the flow itself is the zone parameter flow_estimate.
+ */
+class FlowEstimator {
+public:
+	/**
+	 * Constructor
+	 */
+	FlowEstimator() :
+			p(FLOW::P_START) {
+	}
+
+	unsigned long update(unsigned long flow, unsigned long seconds,
+			unsigned long volume);
+
+private:
+	float p;	// Estimate variance
+};
+
+#endif
@@ -1,23 +1,32 @@
 // Do not remove the include below
 #include "MachineState.h"
 
-#include <ESP8266HTTPClient.h>
+#include "BufferStream.h"
+#include "TraceStream.h"
 
 /**
  * Constructor
  */
 MachineState::MachineState() {
-	params[PRM::P1_FLOW_REQUEST] = &p1_flow_request;
-	params[PRM::P2_FLOW_REQUEST] = &p2_flow_request;
-	params[PRM::P3_FLOW_REQUEST] = &p3_flow_request;
-
-	params[PRM::P1_FLOW_CAPACITY] = &p1_flow_capacity;
-	params[PRM::P2_FLOW_CAPACITY] = &p2_flow_capacity;
-	params[PRM::P3_FLOW_CAPACITY] = &p3_flow_capacity;
+	for (byte k = 0; k < ZONE::COUNT; k++) {
+		params[PRM::zoneId(k, PRM::Z_FLOW_CAPACITY)] = &zones[k].flow_capacity;
+		params[PRM::zoneId(k, PRM::Z_FLOW_REQUEST)] = &zones[k].flow_request;
+		params[PRM::zoneId(k, PRM::Z_PUMPED_VOL)] = &zones[k].pumped_vol;
+		params[PRM::zoneId(k, PRM::Z_WINDOW_START)] = &zones[k].window_start;
+		params[PRM::zoneId(k, PRM::Z_WINDOW_END)] = &zones[k].window_end;
+		params[PRM::zoneId(k, PRM::Z_DAILY_BUDGET)] = &zones[k].daily_budget;
+		params[PRM::zoneId(k, PRM::Z_PUMPED_TODAY)] = &zones[k].pumped_today;
+		params[PRM::zoneId(k, PRM::Z_LAST_START)] = &zones[k].last_start;
+		params[PRM::zoneId(k, PRM::Z_FLOW_ESTIMATE)] = &zones[k].flow_estimate;
+		zones[k].pump.attach(&outputs, &ontime);
+	}
 
-	params[PRM::P1_PUMPED_VOL] = &pumped1;
-	params[PRM::P2_PUMPED_VOL] = &pumped2;
-	params[PRM::P3_PUMPED_VOL] = &pumped3;
+	// Old pump ids of the first zones
+	for (byte k = 0; k < PRM::LEGACY_ZONES && k < ZONE::COUNT; k++) {
+		params[PRM::P1_FLOW_CAPACITY + k] = &zones[k].flow_capacity;
+		params[PRM::P1_FLOW_REQUEST + k] = &zones[k].flow_request;
+		params[PRM::P1_PUMPED_VOL + k] = &zones[k].pumped_vol;
+	}
 
 	params[PRM::TANK_SIZE] = &tanksize;
 	params[PRM::ONTIME] = &ontime;
@@ -29,6 +38,87 @@ MachineState::MachineState() {
 	params[PRM::ADC4] = &adc4;
 
 	params[PRM::LAST_ERR] = &last_err;
+
+	params[PRM::WIFI_CONN_TIME] = &wifi_conn_time;
+	params[PRM::WIFI_RSSI] = &wifi_rssi;
+
+	params[PRM::SYNC_DEBOUNCE] = &sync_debounce;
+	params[PRM::PAUSE] = &pause;
+
+	params[PRM::ADC_CAL] = &adc_cal;
+	params[PRM::ADC1_ENG] = &adc1_eng;
+	params[PRM::ADC2_ENG] = &adc2_eng;
+	params[PRM::ADC3_ENG] = &adc3_eng;
+	params[PRM::ADC4_ENG] = &adc4_eng;
+
+	params[PRM::ADC1_FINE] = &adc1_fine;
+	params[PRM::ADC2_FINE] = &adc2_fine;
+	params[PRM::ADC3_FINE] = &adc3_fine;
+	params[PRM::ADC4_FINE] = &adc4_fine;
+
+	params[PRM::ADC_OVERSAMPLE] = &adc_oversample;
+	params[PRM::ADC_EMA] = &adc_ema;
+	params[PRM::ADC_SETTLE] = &adc_settle;
+
+	params[PRM::HEAP_FREE] = &heap_free;
+	params[PRM::HEAP_MAX_BLOCK] = &heap_max_block;
+	params[PRM::HEAP_FRAG] = &heap_frag;
+
+	params[PRM::TRACE_ENABLE] = &trace_enable;
+	params[PRM::TRACE_UPLOAD] = &trace_upload;
+
+	params[PRM::MQTT_ENABLE] = &mqtt_enable;
+
+	params[PRM::TLS_HANDSHAKE] = &tls_handshake;
+	params[PRM::TLS_HEAP] = &tls_heap;
+
+	params[PRM::TIME] = &time_now;
+	params[PRM::TZ_OFFSET] = &tz_offset;
+	params[PRM::BUDGET_DAY] = &budget_day;
+
+	params[PRM::FLOW_LEVEL_CH] = &flow_level_ch;
+	params[PRM::PUMP_CURRENT_CH] = &pump_current_ch;
+	params[PRM::PUMP_CURRENT_MIN] = &pump_current_min;
+	params[PRM::PUMP_CURRENT_MAX] = &pump_current_max;
+	params[PRM::PUMP_FAULT] = &pump_fault;
+
+	// Keep the server connection open between download and upload
+	http.setReuse(true);
+}
+
+/**
+ * Set default parameter values and read back the parameters kept in EEPROM,
+ * see loadSaved(). All other parameters are initialized to their lower limit.
+ * Call EEPROM.begin() first!
+ */
+void MachineState::begin() {
+	refresh.set(10000);
+	sync_debounce.set(50);
+	adc_oversample.set(2);
+	adc_ema.set(1);
+	trace_enable.set(1);
+	tz_offset.set(720);
+
+	for (byte k = 0; k < ZONE::COUNT; k++) {
+		loadSaved(&zones[k].pumped_vol,
+				k < PRM::LEGACY_ZONES ? PRM::P1_PUMPED_VOL + k : PRM::NONE);
+		loadSaved(&zones[k].pumped_today, PRM::NONE);
+		loadSaved(&zones[k].last_start, PRM::NONE);
+		loadSaved(&zones[k].flow_estimate, PRM::NONE);
+	}
+	loadSaved(&budget_day, PRM::NONE);
+	calibration.load();
+}
+
+/**
+ * Connect or stay connected to the best known WiFi network and update the
+ * link quality parameters. Returns true when connected.
+ */
+bool MachineState::connectWifi() {
+	bool connected = wifi.roam();
+	wifi_conn_time.set(wifi.connect_time);
+	wifi_rssi.set(connected ? -WiFi.RSSI() : 0);
+	return connected;
 }
 
 /**
@@ -37,7 +127,7 @@ MachineState::MachineState() {
  * get. An ending parameter value of NONE ends the request for parameters.
  * Method sets the upload flag of parameters to send.
  */
-bool MachineState::parseParamGetRequest(WiFiClient * const stream) {
+bool MachineState::parseParamGetRequest(Stream * const stream) {
 	prmid_t prm_id;
 
 	if (stream == nullptr) {
@@ -45,17 +135,15 @@ bool MachineState::parseParamGetRequest(WiFiClient * const stream) {
 		return false;
 	}
 
-	Serial.print("\tPrm=");
+	if (!quiet) {
+		Serial.print("\tPrm=");
+	}
 	while (stream->available()) {
 		// Extract parameter
 		prm_id = stream->read();
-		Serial.print(prm_id, DEC);
-		Serial.print(' ');
-
-		if (prm_id >= PRM::_END) {
-			// Unknown command
-			reportFault(ERR::PARAMID_GET_ERR, "Prm " + String(prm_id));
-			break;
+		if (!quiet) {
+			Serial.print(prm_id, DEC);
+			Serial.print(' ');
 		}
 
 		// Stop when hitting NONE parameter
@@ -63,6 +151,12 @@ bool MachineState::parseParamGetRequest(WiFiClient * const stream) {
 			return true;
 		}
 
+		if (prm_id >= PRM::ID_END || params[prm_id] == nullptr) {
+			// Unknown command
+			reportFault(ERR::PARAMID_GET_ERR, "Prm ", prm_id);
+			break;
+		}
+
 		// Flag to upload
 		params[prm_id]->upload = true;
 	}
@@ -76,7 +170,7 @@ bool MachineState::parseParamGetRequest(WiFiClient * const stream) {
  * Byte P is the parameter id and bytes A to D the parameter value.
  * Byte a is the most significant byte of the value.
  */
-bool MachineState::parseParamSetRequest(WiFiClient * const stream) {
+bool MachineState::parseParamSetRequest(Stream * const stream) {
 	unsigned int read_length;
 	unsigned long val;
 	int stream_data;
@@ -88,7 +182,9 @@ bool MachineState::parseParamSetRequest(WiFiClient * const stream) {
 		return false;
 	}
 
-	Serial.print("\t(Prm,Val)=");
+	if (!quiet) {
+		Serial.print("\t(Prm,Val)=");
+	}
 	while (stream->available()) {
 		// Extract parameter
 		stream_data = stream->read();
@@ -100,17 +196,17 @@ bool MachineState::parseParamSetRequest(WiFiClient * const stream) {
 
 		prm_id = (prmid_t) stream_data;
 
-		if (prm_id >= PRM::_END) {
-			// Unknown parameter
-			reportFault(ERR::PARAMID_SET_ERR, "Prm " + String(prm_id));
-			break;
-		}
-
 		// Stop at the NONE parameter
 		if (prm_id == PRM::NONE) {
 			return true;
 		}
 
+		if (prm_id >= PRM::ID_END || params[prm_id] == nullptr) {
+			// Unknown parameter
+			reportFault(ERR::PARAMID_SET_ERR, "Prm ", prm_id);
+			break;
+		}
+
 		// Retrive the parameter value
 		read_length = stream->readBytes(msg_buffer, sizeof(msg_buffer));
 		if (read_length == 0) {
@@ -121,7 +217,7 @@ bool MachineState::parseParamSetRequest(WiFiClient * const stream) {
 
 		if (read_length < sizeof(msg_buffer)) {
 			// Failed to get message id and length.
-			reportFault(ERR::PARAMVAL_SET_ERR, "param " + String(prm_id));
+			reportFault(ERR::PARAMVAL_SET_ERR, "param ", prm_id);
 			break;
 		}
 
@@ -133,15 +229,27 @@ bool MachineState::parseParamSetRequest(WiFiClient * const stream) {
 
 		(params[prm_id])->set(val);
 
-		Serial.print("(");
-		Serial.print(prm_id, DEC);
-		Serial.print(',');
-		Serial.print(val, DEC);
-		Serial.print(",");
-		Serial.print((params[prm_id])->get(), DEC);
-		Serial.print(") ");
+		// Calibration points are applied as they arrive
+		if (prm_id == PRM::ADC_CAL && !calibration.setPoint(val)) {
+			reportFault(ERR::PARAMVAL_SET_ERR, "cal ", val);
+		}
+
+		// Setting the time sets the clock
+		if (prm_id == PRM::TIME) {
+			clock.set(val);
+		}
+
+		if (!quiet) {
+			Serial.print("(");
+			Serial.print(prm_id, DEC);
+			Serial.print(',');
+			Serial.print(val, DEC);
+			Serial.print(",");
+			Serial.print((params[prm_id])->get(), DEC);
+			Serial.print(") ");
 
-		delay(1);
+			delay(1);
+		}
 	}
 	return false;
 }
@@ -157,63 +265,22 @@ bool MachineState::parseParamSetRequest(WiFiClient * const stream) {
  * - 1 byte; Command CMD::NONE
  */
 void MachineState::uploadToServer() {
-	const unsigned short content_lenght = (PRM::_END - 1) * 5 + 5;
-	byte buffer[content_lenght];
 	bool resetLastErr = false;
-	unsigned long val;
 	unsigned short byteno;
-	HTTPClient http;
+	size_t len;
 
 	Serial.print("\nUpload");
 
-	http.setTimeout(WIFI::WIFI_RX_TIMEOUT);
-	http.begin(WIFI::upload_url);
-
-	byteno = 0;
-
-	// Add chip id to data buffer
-	val = ESP.getChipId();
-	buffer[byteno] = (byte) (val >> 16);
-	buffer[++byteno] = (byte) (val >> 8);
-	buffer[++byteno] = (byte) val;
-
-	// Add command to data buffer
-	buffer[++byteno] = CMD::SET;
-
-	// Add parameters to data buffer
-	for (byte k = 0; k < PRM::_END; k++) {
-		if (params[k] && params[k]->upload) {
-
-			if (k == PRM::LAST_ERR) {
-				// Last error code should be reset if successfully uploaded.
-				resetLastErr = true;
-			}
-
-			readADC(k); 	// Read ADC values (only for related parameters)
-
-			params[k]->upload = false;
-
-			val = params[k]->get();
-
-			buffer[++byteno] = k;
-			buffer[++byteno] = (byte) (val >> 24);
-			buffer[++byteno] = (byte) (val >> 16);
-			buffer[++byteno] = (byte) (val >> 8);
-			buffer[++byteno] = (byte) val;
-		}
+	if (!beginRequest(WIFI::upload_path, false)) {
+		return;
 	}
-	buffer[++byteno] = (byte) PRM::NONE;
 
-	++byteno;
-	if (byteno > sizeof(buffer)) {
-		reportFault(ERR::BUFFER_OVERRUN, "");
-		//Serial.print("\n**buffer overrun");
-		byteno = sizeof(buffer);
-	}
+	byteno = packFlaggedParams(packet, sizeof(packet), &resetLastErr);
 
 	// Send parameters if there are at least 5 bytes in the buffer.
 	if (byteno > 4) {
-		int http_code = http.POST((uint8_t *) buffer, (size_t) byteno);
+		int http_code = http.POST((uint8_t *) packet, (size_t) byteno);
+		endRequestTiming();
 
 		Serial.print("\nHttp code: ");
 		Serial.print(http_code, DEC);
@@ -231,7 +298,6 @@ void MachineState::uploadToServer() {
 			}
 
 			// Print response
-			String response_str;
 			WiFiClient * stream = http.getStreamPtr();
 			if (stream == nullptr) {
 				reportFault(ERR::NULLPTR_ERR, "");
@@ -239,8 +305,9 @@ void MachineState::uploadToServer() {
 				return;
 			}
 			while (stream->available()) {
-				response_str = stream->readStringUntil('\n');
-				Serial.println(response_str);
+				len = stream->readBytesUntil('\n', line, sizeof(line) - 1);
+				line[len] = '\0';
+				Serial.println(line);
 			}
 			stream->flush();
 
@@ -257,22 +324,23 @@ void MachineState::uploadToServer() {
  * Download parameters from server
  */
 void MachineState::downloadFromServer() {
-	int stream_data;
+	static const char * date_header[] = { "Date" };
 	int http_code;
-	cmdid_t cmd_id;
 
 	Serial.print("\nDownload ");
 
-	HTTPClient http;
-	http.setTimeout(WIFI::WIFI_RX_TIMEOUT);
-
 	// Include chip id in url query
-	String url = String(WIFI::download_url);
-	url += "?cid=";
-	url += String(ESP.getChipId(), HEX);
-	http.begin(url);
+	if (!beginRequest(WIFI::download_path, true)) {
+		return;
+	}
 
+	// Set the clock from the server until SNTP has answered
+	bool want_date = !clock.synced();
+	if (want_date) {
+		http.collectHeaders(date_header, 1);
+	}
 	http_code = http.GET();
+	endRequestTiming();
 	Serial.print("\nHttp code: ");
 	Serial.print(http_code, DEC);
 
@@ -283,6 +351,11 @@ void MachineState::downloadFromServer() {
 		return;
 	}
 
+	if (want_date) {
+		clock.setFromHttpDate(http.header("Date").c_str());
+		http.collectHeaders(date_header, 0);	// Stop storing it once read
+	}
+
 	//
 	// Start of message data
 	//
@@ -294,6 +367,365 @@ void MachineState::downloadFromServer() {
 		return;
 	}
 
+	parseCommandStream(stream);
+
+	stream->flush();
+	http.end();
+	Serial.println("\nDone download");
+}
+
+/**
+ * Upload the input trace if requested by parameter PRM::TRACE_UPLOAD. The
+ * trace is cleared and the request reset when the server accepted it.
+ */
+void MachineState::uploadTrace() {
+	int http_code;
+
+	if (!trace_upload.get()) {
+		return;
+	}
+
+	Serial.print("\nTrace upload ");
+	Serial.print(trace.size(), DEC);
+
+	if (!beginRequest(WIFI::trace_path, true)) {
+		return;
+	}
+
+	http_code = http.POST((uint8_t *) trace.linearize(), trace.size());
+	endRequestTiming();
+	Serial.print("\nHttp code: ");
+	Serial.print(http_code, DEC);
+
+	if (http_code == HTTP_CODE_OK) {
+		trace.clear();
+		trace_upload.set(0);
+	} else {
+		Serial.print(", **failed");
+	}
+	http.end();
+}
+
+/**
+ * Configure the TLS transport. Call once WiFi is connected. The server is
+ * verified by WIFI::tls_fingerprint or WIFI::tls_trust_anchor, without either
+ * all requests fail. Buffers are reduced to WIFI::tls_fragment bytes if the
+ * server supports maximum fragment length negotiation.
+ */
+void MachineState::beginTls() {
+	bool mfln;
+
+	if (!WIFI::use_tls) {
+		return;
+	}
+
+	if (WIFI::tls_fingerprint != nullptr) {
+		tls_trusted = tls_net.setFingerprint(WIFI::tls_fingerprint);
+	} else if (WIFI::tls_trust_anchor != nullptr) {
+		if (tls_anchors == nullptr) {
+			tls_anchors = new BearSSL::X509List(WIFI::tls_trust_anchor);
+		}
+		tls_net.setTrustAnchors(tls_anchors);
+		tls_trusted = true;
+	}
+	if (!tls_trusted) {
+		reportFault(ERR::TLS_UNTRUSTED, "");
+		return;
+	}
+	tls_net.setSession(&tls_session);
+
+	mfln = tls_net.probeMaxFragmentLength(wifi.host(), WIFI::https_port,
+			WIFI::tls_fragment);
+	if (mfln) {
+		tls_net.setBufferSizes(WIFI::tls_fragment, WIFI::tls_fragment);
+	}
+	Serial.print("\nTLS MFLN ");
+	Serial.print(mfln ? "yes" : "no");
+}
+
+/**
+ * Begin a request to path on the server host. HTTPClient opens the connection
+ * with the request, the TLS connection is kept between requests and resumes
+ * the previous session when reopened. When the request opens it, call
+ * endRequestTiming() after the request. Returns false if the server can not
+ * be verified.
+ *
+ * @param path Url path.
+ * @param add_cid True to add the chip id as query cid.
+ */
+bool MachineState::beginRequest(const char * const path, const bool add_cid) {
+	uint16_t port = WIFI::use_tls ? WIFI::https_port : WIFI::http_port;
+
+	if (WIFI::use_tls && !tls_trusted) {
+		// Fail closed, never talk to an unverified server
+		reportFault(ERR::TLS_UNTRUSTED, "");
+		return false;
+	}
+
+	// Time the request which sets up the TLS connection
+	tls_opening = WIFI::use_tls && !tls_net.connected();
+	if (tls_opening) {
+		tls_open_start = millis();
+		tls_open_heap = ESP.getFreeHeap();
+	}
+
+	if (add_cid) {
+		snprintf(url, sizeof(url), "%s://%s:%u%s?cid=%x",
+				WIFI::use_tls ? "https" : "http", wifi.host(), port, path,
+				ESP.getChipId());
+	} else {
+		snprintf(url, sizeof(url), "%s://%s:%u%s",
+				WIFI::use_tls ? "https" : "http", wifi.host(), port, path);
+	}
+
+	http.setTimeout(WIFI::WIFI_RX_TIMEOUT);
+	if (WIFI::use_tls) {
+		return http.begin(tls_net, url);
+	}
+	return http.begin(plain_net, url);
+}
+
+/**
+ * Update TLS_HANDSHAKE and TLS_HEAP if the request just made opened the TLS
+ * connection, the time includes the request. Reports the TLS error if the
+ * connection could not be set up.
+ */
+void MachineState::endRequestTiming() {
+	if (!tls_opening) {
+		return;
+	}
+	tls_opening = false;
+
+	if (!tls_net.connected()) {
+		reportFault(ERR::CONN_ERR, "tls ", tls_net.getLastSSLError());
+		return;
+	}
+	tls_handshake.set(millis() - tls_open_start);
+	tls_heap.set(tls_open_heap - ESP.getFreeHeap());
+}
+
+/**
+ * Start listening for local clients on port WIFI::lan_port. Call once WiFi is
+ * connected.
+ */
+void MachineState::beginLocalServer() {
+	lan_server.begin();
+	lan_server.setNoDelay(true);
+	Serial.print("\nLAN port ");
+	Serial.print(WIFI::lan_port, DEC);
+}
+
+/**
+ * Serve a local client without blocking the program loop. A client sends the
+ * same command stream as the server download (e.g. CMD::SET followed by PABCD
+ * repetitions and PRM::NONE). The stream may arrive in several TCP segments,
+ * it is collected until the ending CMD::NONE and then applied. A stream that
+ * stays incomplete for WIFI::LAN_IDLE_TIMEOUT is applied as far as it goes.
+ * The reply is the upload stream of flagged parameters, after which the
+ * connection is closed. Only one client is served at a time.
+ * PRM::LAST_ERR is not reset by a local reply, it is kept for the server.
+ *
+ * @param now Milliseconds from power on taken at start of each program loop.
+ */
+void MachineState::serveLocalClient(unsigned long now) {
+	bool lastErrSent = false;
+	unsigned short byteno;
+	int n;
+
+	if (!lan_client || !lan_client.connected()) {
+		// Accept a new client if one is waiting
+		lan_client = lan_server.available();
+		if (!lan_client) {
+			return;
+		}
+		lan_client_heard = now;
+		lan_rx_len = 0;
+	}
+
+	n = min(lan_client.available(), (int) (sizeof(lan_rx) - lan_rx_len));
+	if (n > 0) {
+		lan_rx_len += lan_client.read(lan_rx + lan_rx_len, n);
+		lan_client_heard = now;
+	}
+
+	if (lan_rx_len < sizeof(lan_rx) && !commandComplete(lan_rx, lan_rx_len)) {
+		if (now - lan_client_heard <= WIFI::LAN_IDLE_TIMEOUT) {
+			return;
+		}
+		if (lan_rx_len == 0) {
+			// Silent for too long
+			lan_client.stop();
+			return;
+		}
+	}
+
+	Serial.print("\nLAN request");
+	BufferStream stream(lan_rx, lan_rx_len);
+	parseCommandStream(&stream);
+	lan_rx_len = 0;
+
+	// Reply with flagged parameters
+	byteno = packFlaggedParams(packet, sizeof(packet), &lastErrSent);
+	lan_client.write(packet, byteno);
+
+	lan_client.flush();
+	lan_client.stop();
+}
+
+/**
+ * Set up the MQTT session. The broker runs on the server host. Connection is
+ * made by serveMqtt() when parameter PRM::MQTT_ENABLE is set.
+ */
+void MachineState::beginMqtt() {
+	snprintf(mqtt_cmd_topic, sizeof(mqtt_cmd_topic), WIFI::mqtt_cmd_topic,
+			ESP.getChipId());
+	snprintf(mqtt_prm_topic, sizeof(mqtt_prm_topic), WIFI::mqtt_prm_topic,
+			ESP.getChipId());
+	mqtt_retry = WIFI::MQTT_RETRY;
+	mqtt_last_try = millis() - mqtt_retry;
+
+	// Connecting blocks the program loop, keep it short when the broker is
+	// down. The broker is on the local network.
+	mqtt_net.setTimeout(WIFI::MQTT_CONNECT_TIMEOUT);
+	mqtt.setSocketTimeout(WIFI::MQTT_SOCKET_TIMEOUT);
+	mqtt.setBufferSize(MEM::PACKET_SIZE + MEM::TOPIC_SIZE + 8);
+	mqtt.setCallback([this](char * topic, byte * payload, unsigned int length) {
+		onMqttMessage(topic, payload, length);
+	});
+}
+
+/**
+ * Keep the MQTT session alive. Commands received on the command topic are
+ * applied at once. Parameters which changed or were requested are published
+ * on the parameter topic in the upload format, see uploadToServer().
+ * PRM::LAST_ERR is not reset by a publish, which is not acknowledged at QoS 0,
+ * it is kept for the server.
+ *
+ * A reconnect attempt stalls the loop for up to WIFI::MQTT_CONNECT_TIMEOUT.
+ * While the broker is down attempts back off from WIFI::MQTT_RETRY to
+ * WIFI::MQTT_RETRY_MAX.
+ *
+ * @param now Milliseconds from power on taken at start of each program loop.
+ */
+void MachineState::serveMqtt(unsigned long now) {
+	bool lastErrSent = false;
+	bool flagged = false;
+	unsigned short byteno;
+
+	if (!mqtt_enable.get()) {
+		if (mqtt.connected()) {
+			mqtt.disconnect();
+		}
+		return;
+	}
+
+	if (!mqtt.connected()) {
+		// Back off while the broker is unreachable
+		if (now - mqtt_last_try >= mqtt_retry) {
+			mqtt_last_try = now;
+			if (connectMqtt()) {
+				mqtt_retry = WIFI::MQTT_RETRY;
+			} else {
+				mqtt_retry = min(2 * mqtt_retry, WIFI::MQTT_RETRY_MAX);
+			}
+		}
+		return;
+	}
+
+	mqtt.loop(); // Receives commands
+
+	if (!mqtt_pending && now - mqtt_last_publish < WIFI::MQTT_PUBLISH_INTERVAL) {
+		return;
+	}
+	mqtt_last_publish = now;
+	mqtt_pending = false;
+
+	// Flag changed parameters
+	for (unsigned int k = 0; k < PRM::ID_END; k++) {
+		if (params[k] && params[k]->get() != published[k]) {
+			params[k]->upload = true;
+		}
+		flagged = flagged || (params[k] && params[k]->upload);
+	}
+	if (!flagged) {
+		return;
+	}
+
+	byteno = packFlaggedParams(packet, sizeof(packet), &lastErrSent);
+	for (unsigned int k = 0; k < PRM::ID_END; k++) {
+		if (params[k]) {
+			published[k] = params[k]->get();
+		}
+	}
+
+	mqtt.publish(mqtt_prm_topic, packet, byteno);
+}
+
+/**
+ * Connect to the broker with a persistent session and subscribe to the
+ * command topic. All parameters are published after connecting. Returns true
+ * on success.
+ */
+bool MachineState::connectMqtt() {
+	char client_id[12];
+
+	Serial.print("\nMQTT connect");
+
+	snprintf(client_id, sizeof(client_id), "hw-%x", ESP.getChipId());
+	mqtt.setServer(wifi.host(), WIFI::mqtt_port);
+
+	// Keep the session (clean session false) so commands sent while
+	// disconnected are delivered.
+	if (!mqtt.connect(client_id, WIFI::mqtt_user, WIFI::mqtt_pass, nullptr, 0,
+			false, nullptr, false)) {
+		Serial.print(", **failed ");
+		Serial.print(mqtt.state(), DEC);
+		return false;
+	}
+
+	mqtt.subscribe(mqtt_cmd_topic, 1);
+
+	for (unsigned int k = 0; k < PRM::ID_END; k++) {
+		if (params[k]) {
+			params[k]->upload = true;
+		}
+	}
+	mqtt_pending = true;
+	return true;
+}
+
+/**
+ * Apply a command message. The payload is a command stream as served by the
+ * server download. Publishing is not allowed from within the callback, so
+ * replies are sent by serveMqtt().
+ */
+void MachineState::onMqttMessage(char * topic, byte * payload,
+		unsigned int length) {
+	BufferStream stream(payload, length);
+
+	(void) topic;
+	Serial.print("\nMQTT request");
+	parseCommandStream(&stream);
+	mqtt_pending = true;
+}
+
+/**
+ * Parse a stream of commands. Each command byte is followed by its data and
+ * the stream ends with CMD::NONE. Returns true if the stream ended properly.
+ * The bytes read are recorded to the input trace as received.
+ */
+bool MachineState::parseCommandStream(Stream * const source) {
+	int stream_data;
+	cmdid_t cmd_id;
+
+	if (source == nullptr) {
+		reportFault(ERR::NULLPTR_ERR, "");
+		return false;
+	}
+
+	TraceStream traced { source, &trace };
+	Stream * const stream = &traced;
+
 	while (stream->available()) {
 
 		// Retrive command
@@ -309,99 +741,470 @@ void MachineState::downloadFromServer() {
 		// Parse data for command
 		if (cmd_id == CMD::SET) {
 			if (!parseParamSetRequest(stream)) {
-				break;
+				return false;
 			}
 
 		} else if (cmd_id == CMD::GET) {
 			if (!parseParamGetRequest(stream)) {
-				break;
+				return false;
 			}
 
 		} else if (cmd_id == CMD::NONE) {
-			break;
+			return true;
 
 		} else {
-			reportFault(ERR::BAD_COMMAND_ERR, "cmd " + String(cmd_id));
+			reportFault(ERR::BAD_COMMAND_ERR, "cmd ", cmd_id);
 			printErrorStream(stream);
-			break;
+			return false;
 
 		}
 		delay(2);
 		yield();
 	}
+	return false;
+}
 
-	stream->flush();
-	http.end();
-	Serial.println("\nDone download");
+/**
+ * Pack flagged parameters into buffer and clear their upload flags. Returns
+ * the number of bytes used. See uploadToServer() for the format.
+ *
+ * @param buffer Buffer to fill.
+ * @param size Size of buffer in bytes.
+ * @param reset_last_err Set true if PRM::LAST_ERR was packed.
+ */
+unsigned short MachineState::packFlaggedParams(byte * const buffer,
+		const unsigned short size, bool * const reset_last_err) {
+	unsigned long val;
+	unsigned short byteno;
+
+	byteno = 0;
+
+	// Add chip id to data buffer
+	val = ESP.getChipId();
+	buffer[byteno] = (byte) (val >> 16);
+	buffer[++byteno] = (byte) (val >> 8);
+	buffer[++byteno] = (byte) val;
+
+	// Add command to data buffer
+	buffer[++byteno] = CMD::SET;
+
+	// Add parameters to data buffer
+	for (unsigned int k = 0; k < PRM::ID_END; k++) {
+		if (params[k] && params[k]->upload) {
+
+			if (byteno + 6 >= size) {
+				// No room for parameter and ending NONE
+				reportFault(ERR::BUFFER_OVERRUN, "");
+				break;
+			}
+
+			if (k == PRM::LAST_ERR) {
+				// Last error code should be reset if successfully uploaded.
+				*reset_last_err = true;
+			}
+
+			readADC(k); 	// Read ADC values (only for related parameters)
+			readHeap(k); 	// Read heap status (only for related parameters)
+			readClock(k); 	// Read wall clock (only for related parameters)
+
+			params[k]->upload = false;
+
+			val = params[k]->get();
+
+			buffer[++byteno] = k;
+			buffer[++byteno] = (byte) (val >> 24);
+			buffer[++byteno] = (byte) (val >> 16);
+			buffer[++byteno] = (byte) (val >> 8);
+			buffer[++byteno] = (byte) val;
+		}
+	}
+	buffer[++byteno] = (byte) PRM::NONE;
+
+	return ++byteno;
+}
+
+/**
+ * Start SNTP against the server host. The clock takes the time at the next
+ * refresh after an answer. Call once WiFi is connected.
+ */
+void MachineState::beginClock() {
+	configTime(0, 0, wifi.host());
 }
 
 /**
- * Call to update state of pumps
+ * Call to update state of pumps. With a synced clock pumps only start inside
+ * the watering window of their zone, and no zone pumps more than its daily
+ * budget per local day. Running pumps are monitored, see checkFlow(), and a
+ * zone with a pump fault does not start until PRM::PUMP_FAULT is cleared.
+ * A pump run is saved to EEPROM with one flash write when it stops, see
+ * saveRun().
  *
- * @param now Milliseconds from power on taken at start of each program loop.
+ * @param now Milliseconds from power on, see Clock::update().
  */
-void MachineState::run(unsigned long now) {
-	// Run the pumps.
-	yield(); // Let the ESP8266 do its thing too
-	p1.run(now, remainingTankVolume() == 0 || p2.isOn() || p3.isOn());
-	yield(); // Let the ESP8266 do its thing too
-	p2.run(now, remainingTankVolume() == 0 || p3.isOn() || p1.isOn());
-	yield(); // Let the ESP8266 do its thing too
-	p3.run(now, remainingTankVolume() == 0 || p1.isOn() || p2.isOn());
+void MachineState::run(uint64_t now) {
+	bool stop = pause.get() || remainingTankVolume() == 0;
+	bool was_on;
+	bool closed;
+	bool faulted;
+	unsigned long pumped;
+	unsigned int minute = clock.localMinute();
+	byte trace_rec;
+
+	if (!starts_restored && clock.synced()) {
+		restoreStarts(now);
+	}
+	rollDay();
+
+	// Run the pumps. Only one pump at a time may run, so a pump is inhibited
+	// if any other pump is running.
+	for (byte k = 0; k < ZONE::COUNT; k++) {
+		Zone * const zone = &zones[k];
+		Pump * const pump = &zone->pump;
+
+		yield(); // Let the ESP8266 do its thing too
+		was_on = pump->isOn();
+		if (was_on) {
+			checkFlow(k, now);
+		}
+		pumped = zone->pumped_vol.get();
+		closed = clock.synced() && !zone->windowOpen(minute);
+		faulted = pump_fault.get() & (1UL << k);
+		pump->run(now,
+				stop || closed || faulted || running > (was_on ? 1 : 0),
+				zone->budgetLeft());
+
+		// Account the delivered volume to the day
+		if (zone->pumped_vol.get() != pumped) {
+			zone->pumped_today.set(
+					zone->pumped_today.get() + zone->pumped_vol.get() - pumped);
+		}
+
+		if (pump->isOn() != was_on) {
+			was_on ? --running : ++running;
+
+			// Record pump decisions to compare with replays
+			trace_rec = (k << 1) | !was_on;
+			trace.record(TRC::PUMP, &trace_rec, 1);
+
+			// Keep the start so dosing continues after a reboot
+			if (!was_on && clock.synced()) {
+				zone->last_start.set(clock.epoch());
+			}
+
+			if (!was_on) {
+				beginFlowCheck(now);
+			} else {
+				if (!faulted) {
+					endFlowCheck(k, (now - pump->last_switch_on) / 1000);
+				}
+				saveRun(zone);
+			}
+		}
+	}
+}
+
+/**
+ * Prime the pumps in turn, one per call, for ontime seconds. Nothing is done
+ * if watering is paused or a pump is running. Returns true if a pump started.
+ *
+ * @param now Milliseconds from power on, see Clock::update().
+ */
+bool MachineState::primeNextPump(uint64_t now) {
+	byte trace_rec = (next_prime << 1) | 1;
+
+	if (pause.get() || running > 0) {
+		return false;
+	}
+
+	zones[next_prime].pump.prime(now, ontime.get());
+	trace.record(TRC::PUMP, &trace_rec, 1);
+	beginFlowCheck(now);
+	++running;
+	next_prime = (next_prime + 1) % ZONE::COUNT;
+	return true;
 }
 
 /**
- * Read ADC analogue inputs for parameter pid. If pid is not
- * PRM:ADC1..4 nothing is read.
+ * Read ADC analogue inputs for parameter pid. The raw, fine and calibrated
+ * parameters of the channel are all updated. If pid is not PRM:ADC1..4,
+ * PRM::ADC1_ENG..ADC4_ENG or PRM::ADC1_FINE..ADC4_FINE nothing is read.
  *
  * @param pid Parameter id.
  */
 void MachineState::readADC(prmid_t pid) {
-	unsigned int val;
-	byte k;
+	unsigned long fine;
+	byte channel;
+
+	if (pid >= PRM::ADC1 && pid <= PRM::ADC4) {
+		channel = pid - PRM::ADC1;
+	} else if (pid >= PRM::ADC1_ENG && pid <= PRM::ADC4_ENG) {
+		channel = pid - PRM::ADC1_ENG;
+	} else if (pid >= PRM::ADC1_FINE && pid <= PRM::ADC4_FINE) {
+		channel = pid - PRM::ADC1_FINE;
+	} else {
+		return; // pid is not a ADC parameter
+	}
 
 	// Select mutiplexer input
+	digitalWrite(PINS::MPX_S0, (channel & 0x01) ? HIGH : LOW);
+	digitalWrite(PINS::MPX_S1, (channel & 0x02) ? HIGH : LOW);
+
+	// Enable mutiplexer
+	digitalWrite(PINS::MPX_EN, LOW);
+	// Read filtered voltage and save in parameters. The filter waits for the
+	// analogue value to settle.
+	fine = filter.read(channel);
+	adc_settle.set(filter.maxSettleTime());
+
+	params[PRM::ADC1 + channel]->set(
+			(fine + (1 << (ANALOG::FRACTION_BITS - 1))) >> ANALOG::FRACTION_BITS);
+	params[PRM::ADC1_FINE + channel]->set(fine);
+	params[PRM::ADC1_ENG + channel]->set(calibration.convertFine(channel, fine));
+
+	byte trace_rec[] = { channel, (byte) (fine >> 8), (byte) fine };
+	trace.record(TRC::ADC, trace_rec, sizeof(trace_rec));
+	Serial.print("\nADC ");
+	Serial.print(channel + 1, DEC);
+	Serial.print("=");
+	Serial.print(params[PRM::ADC1 + channel]->get(), DEC);
+	Serial.print(",");
+	Serial.print(params[PRM::ADC1_ENG + channel]->get(), DEC);
+
+	// Disable mutiplexer
+	digitalWrite(PINS::MPX_EN, HIGH);
+}
+
+/**
+ * Read heap status for parameter pid. If pid is not PRM::HEAP_FREE,
+ * PRM::HEAP_MAX_BLOCK or PRM::HEAP_FRAG nothing is read.
+ *
+ * @param pid Parameter id.
+ */
+void MachineState::readHeap(prmid_t pid) {
 	switch (pid) {
-	case PRM::ADC1:
-		digitalWrite(PINS::MPX_S0, LOW);
-		digitalWrite(PINS::MPX_S1, LOW);
-		break;
-	case PRM::ADC2:
-		digitalWrite(PINS::MPX_S0, HIGH);
-		digitalWrite(PINS::MPX_S1, LOW);
+	case PRM::HEAP_FREE:
+		heap_free.set(ESP.getFreeHeap());
 		break;
-	case PRM::ADC3:
-		digitalWrite(PINS::MPX_S0, LOW);
-		digitalWrite(PINS::MPX_S1, HIGH);
+	case PRM::HEAP_MAX_BLOCK:
+		heap_max_block.set(ESP.getMaxFreeBlockSize());
 		break;
-	case PRM::ADC4:
-		digitalWrite(PINS::MPX_S0, HIGH);
-		digitalWrite(PINS::MPX_S1, HIGH);
+	case PRM::HEAP_FRAG:
+		heap_frag.set(ESP.getHeapFragmentation());
 		break;
 	default:
-		return; // pid is not a ADC parameter
+		return; // pid is not a heap parameter
 	}
+}
 
-	// Enable mutiplexer
-	digitalWrite(PINS::MPX_EN, LOW);
-	// Let analogue value settle (not sure if needed)
-	delay(10);
-	// Read and save voltage in parameter. Average of 20 values.
-	val = 0;
-	k = -1;
-	while (++k < 20) {
-		val += analogRead(A0);
+/**
+ * Read the wall clock for parameter pid. If pid is not PRM::TIME nothing is
+ * read.
+ *
+ * @param pid Parameter id.
+ */
+void MachineState::readClock(prmid_t pid) {
+	if (pid == PRM::TIME) {
+		time_now.set(clock.epoch());
 	}
-	val = val / 20;
+}
 
-	params[pid]->set(val);
-	Serial.print("\nADC ");
-	Serial.print(pid, DEC);
-	Serial.print("=");
-	Serial.print(params[pid]->get(), DEC);
+/**
+ * Load a parameter kept in EEPROM. A slot never written, e.g. after a firmware
+ * update added the parameter, reads as erased flash. It is initialized from
+ * the slot of the old id legacy if that was written, else to the lower limit
+ * of the parameter.
+ *
+ * @param prm Parameter to load.
+ * @param legacy Id the value was saved under before, PRM::NONE if none.
+ */
+void MachineState::loadSaved(Parameter * const prm, const prmid_t legacy) {
+	if (!prm->eepromErased()) {
+		prm->eepromLoad();
+		return;
+	}
 
-	// Disable mutiplexer
-	digitalWrite(PINS::MPX_EN, HIGH);
+	if (legacy != PRM::NONE) {
+		Parameter old { legacy, 0, -1UL };
+		if (!old.eepromErased()) {
+			old.eepromLoad();
+			prm->set(old.get());
+		}
+	}
+	prm->eepromSave();
+}
+
+/**
+ * Reset the volumes pumped today when a new local day starts. With a synced
+ * clock the day number is kept in EEPROM so the daily budget holds across
+ * reboots. Without it a day is counted from power on.
+ */
+void MachineState::rollDay() {
+	unsigned long day = clock.localDay();
+
+	if (clock.synced()) {
+		if (day == budget_day.get()) {
+			return;
+		}
+		budget_day.set(day);
+		budget_day.eepromWrite();
+
+	} else {
+		if (day == uptime_day) {
+			return;
+		}
+		uptime_day = day;
+	}
+
+	for (byte k = 0; k < ZONE::COUNT; k++) {
+		zones[k].pumped_today.set(0);
+		zones[k].pumped_today.eepromWrite();
+	}
+	Parameter::eepromCommit();
+}
+
+/**
+ * Save what a finished pump run changed with one flash write: the pumped
+ * volumes, the start of the run and the measured flow.
+ */
+void MachineState::saveRun(Zone * const zone) {
+	bool changed = zone->pumped_vol.eepromWrite();
+	changed |= zone->pumped_today.eepromWrite();
+	changed |= zone->last_start.eepromWrite();
+	changed |= zone->flow_estimate.eepromWrite();
+
+	if (changed) {
+		Parameter::eepromCommit();
+	}
+}
+
+/**
+ * Continue dosing from the pump starts saved before the last reboot, so need
+ * accumulated before it is not lost. Pumps started since power on are left as
+ * they are. Call once the clock is synced.
+ *
+ * @param now Milliseconds from power on, see Clock::update().
+ */
+void MachineState::restoreStarts(uint64_t now) {
+	unsigned long epoch = clock.epoch();
+	unsigned long saved;
+
+	starts_restored = true;
+	for (byte k = 0; k < ZONE::COUNT; k++) {
+		saved = zones[k].last_start.get();
+		if (zones[k].pump.last_switch_on == 0 && saved > 0 && saved <= epoch) {
+			// May lie before power on, the pump only uses the difference
+			zones[k].pump.last_switch_on = now - (uint64_t) (epoch - saved) * 1000;
+		}
+	}
+}
+
+/**
+ * Returns the calibrated value of ADC channel 1..4, see AdcCalibration. The
+ * moving average is restarted first, so a falling tank level or a changing
+ * pump current is not read behind its true value.
+ */
+unsigned long MachineState::readChannel(unsigned long channel) {
+	filter.reset(channel - 1);
+	readADC(PRM::ADC1_ENG + channel - 1);
+	return params[PRM::ADC1_ENG + channel - 1]->get();
+}
+
+/**
+ * Take the tank level at the start of a pump run if PRM::FLOW_LEVEL_CH is
+ * set.
+ *
+ * @param now Milliseconds from power on.
+ */
+void MachineState::beginFlowCheck(unsigned long now) {
+	flow_last_check = now;
+	if (flow_level_ch.get()) {
+		flow_level_start = readChannel(flow_level_ch.get());
+	}
+}
+
+/**
+ * Check a running pump every FLOW::CHECK_INTERVAL once it has run for
+ * FLOW::SPINUP_TIME. With a current channel the pump is faulted as dry if the
+ * current is below PRM::PUMP_CURRENT_MIN and as blocked if above
+ * PRM::PUMP_CURRENT_MAX. With a tank level channel it is faulted if the level
+ * has dropped less than FLOW::MIN_FLOW_PCT percent of the estimated volume
+ * after FLOW::LEVEL_CHECK_TIME.
+ *
+ * @param zone Zone index of the running pump.
+ * @param now Milliseconds from power on, see Clock::update().
+ */
+void MachineState::checkFlow(byte zone, uint64_t now) {
+	Zone * const z = &zones[zone];
+	unsigned long elapsed = now - z->pump.last_switch_on;
+	unsigned long val;
+	unsigned long expected;
+
+	if (elapsed < FLOW::SPINUP_TIME
+			|| (unsigned long) now - flow_last_check < FLOW::CHECK_INTERVAL) {
+		return;
+	}
+	flow_last_check = now;
+
+	if (pump_current_ch.get()) {
+		val = readChannel(pump_current_ch.get());
+		if (val < pump_current_min.get()) {
+			flagPumpFault(zone, ERR::PUMP_DRY);
+			return;
+		}
+		if (pump_current_max.get() && val > pump_current_max.get()) {
+			flagPumpFault(zone, ERR::PUMP_BLOCKED);
+			return;
+		}
+	}
+
+	if (flow_level_ch.get() && elapsed >= FLOW::LEVEL_CHECK_TIME) {
+		val = readChannel(flow_level_ch.get());
+		val = (val < flow_level_start) ? flow_level_start - val : 0;
+		expected = (elapsed / 1000) * z->pump.flow() / 60;
+		if (val * 100 < expected * FLOW::MIN_FLOW_PCT) {
+			flagPumpFault(zone, ERR::PUMP_NO_FLOW);
+		}
+	}
+}
+
+/**
+ * Refine the measured flow capacity of a zone from the tank level drop over a
+ * pump run. The estimate is kept in the zone parameter flow_estimate, apart
+ * from the flow capacity set by the server, and is saved with the run. Nothing
+ * is done without PRM::FLOW_LEVEL_CH, for runs shorter than FLOW::MIN_RUN or if
+ * the level rose, e.g. from a refill.
+ *
+ * @param zone Zone index of the stopped pump.
+ * @param seconds Runtime of the pump [s].
+ */
+void MachineState::endFlowCheck(byte zone, unsigned long seconds) {
+	Zone * const z = &zones[zone];
+	unsigned long level;
+
+	if (!flow_level_ch.get() || seconds < FLOW::MIN_RUN) {
+		return;
+	}
+
+	level = readChannel(flow_level_ch.get());
+	if (level >= flow_level_start) {
+		return;
+	}
+
+	z->flow_estimate.set(
+			z->flow.update(z->pump.flow(), seconds, flow_level_start - level));
+	Serial.print("\nFlow zone ");
+	Serial.print(zone, DEC);
+	Serial.print(", [cc/min]=");
+	Serial.print(z->flow_estimate.get(), DEC);
+}
+
+/**
+ * Flag a pump fault of a zone. The pump is stopped by run() and the zone is
+ * not started until its PRM::PUMP_FAULT bit is cleared.
+ */
+void MachineState::flagPumpFault(byte zone, byte err) {
+	pump_fault.set(pump_fault.get() | (1UL << zone));
+	reportFault(err, "zone ", zone);
 }
 
 /**
@@ -409,16 +1212,46 @@ void MachineState::readADC(prmid_t pid) {
  * Subtracts pumped volumes from tank volume.
  */
 unsigned int MachineState::remainingTankVolume() {
-	unsigned int pumped = pumped1.get() + pumped2.get() + pumped3.get();
+	unsigned int pumped = 0;
+	for (byte k = 0; k < ZONE::COUNT; k++) {
+		pumped += zones[k].pumped_vol.get();
+	}
 	unsigned int tsize = tanksize.get();
 	return (pumped < tsize) ? tsize - pumped : 0;
 }
 
+/**
+ * Returns true if cmds holds a whole command stream, ending with CMD::NONE.
+ * An unknown command also completes it, the parser rejects it.
+ */
+bool MachineState::commandComplete(const byte * const cmds, const size_t len) {
+	size_t pos = 0;
+
+	while (pos < len) {
+		cmdid_t cmd_id = cmds[pos++];
+
+		if (cmd_id == CMD::SET) {
+			// PABCD records up to PRM::NONE
+			while (pos < len && cmds[pos] != PRM::NONE) {
+				pos += 5;
+			}
+		} else if (cmd_id == CMD::GET) {
+			while (pos < len && cmds[pos] != PRM::NONE) {
+				pos++;
+			}
+		} else {
+			return true;
+		}
+		pos++;	// PRM::NONE
+	}
+	return false;
+}
+
 /**
  * Serial print up to 150 bytes from stream for debugging. Flush the stream when
  * done.
  */
-void MachineState::printErrorStream(WiFiClient * const stream) {
+void MachineState::printErrorStream(Stream * const stream) {
 	int stream_data;
 	byte max_count = 150;
 
@@ -449,7 +1282,7 @@ void MachineState::printErrorStream(WiFiClient * const stream) {
  * parameter.
  *
  */
-void MachineState::reportFault(byte err, String err_msg) {
+void MachineState::reportFault(byte err, const char * const err_msg) {
 	last_err.set(err);
 	if (Serial) {
 		Serial.print("\n**Err ");
@@ -458,3 +1291,19 @@ void MachineState::reportFault(byte err, String err_msg) {
 		Serial.println(err_msg);		// Error message
 	}
 }
+
+/**
+ * As reportFault(err, err_msg) with a value, e.g. a parameter id, printed
+ * after the message.
+ */
+void MachineState::reportFault(byte err, const char * const err_msg,
+		unsigned long val) {
+	last_err.set(err);
+	if (Serial) {
+		Serial.print("\n**Err ");
+		Serial.print(err, HEX);		// Error code
+		Serial.print(" : ");
+		Serial.print(err_msg);		// Error message
+		Serial.println(val, DEC);	// Value
+	}
+}
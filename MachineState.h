@@ -2,9 +2,19 @@
 #define MachineState_H_
 
 #include <ESP8266WiFi.h>
+#include <WiFiClientSecureBearSSL.h>
+#include <ESP8266HTTPClient.h>
+#include <PubSubClient.h>
 #include "consts_and_types.h"
+#include "AdcCalibration.h"
+#include "AdcFilter.h"
+#include "Clock.h"
 #include "Parameter.h"
-#include "Pump.h"
+#include "Zone.h"
+#include "ZoneOutputs.h"
+#include "SyncInput.h"
+#include "TraceRecorder.h"
+#include "WifiConfig.h"
 
 class MachineState {
 
@@ -13,18 +23,6 @@ public:
 	// Define parameters with parameter id, min value and max value.
 	// Initial values are loaded from EEPROM.
 	//
-	Parameter p1_flow_request { PRM::P1_FLOW_REQUEST, 0, 1000000UL }; // Requested flow in cc per day. Max 500 cc
-	Parameter p2_flow_request { PRM::P2_FLOW_REQUEST, 0, 1000000UL }; // Requested flow in cc per day. Max 500 cc
-	Parameter p3_flow_request { PRM::P3_FLOW_REQUEST, 0, 1000000UL }; // Requested flow in cc per day. Max 500 cc
-
-	Parameter p1_flow_capacity { PRM::P1_FLOW_CAPACITY, 1, 1000UL }; // Pump flow capacity cc/min
-	Parameter p2_flow_capacity { PRM::P2_FLOW_CAPACITY, 1, 1000UL }; // Pump flow capacity cc/min
-	Parameter p3_flow_capacity { PRM::P3_FLOW_CAPACITY, 1, 1000UL }; // Pump flow capacity cc/min
-
-	Parameter pumped1 { PRM::P1_PUMPED_VOL, 0, -1UL }; // Pumped volume in cc
-	Parameter pumped2 { PRM::P2_PUMPED_VOL, 0, -1UL }; // Pumped volume in cc
-	Parameter pumped3 { PRM::P3_PUMPED_VOL, 0, -1UL }; // Pumped volume in cc
-
 	Parameter tanksize { PRM::TANK_SIZE, 0, -1UL }; // Tank volume in cc
 	Parameter ontime { PRM::ONTIME, 0, -1UL }; // Pump ontime per round in seconds
 	Parameter refresh { PRM::REFRESH_RATE, 0, -1UL }; // Server connection interval in milliseconds
@@ -34,34 +32,192 @@ public:
 	Parameter adc3 { PRM::ADC3, 0, 1023UL }; // ADC3 value
 	Parameter adc4 { PRM::ADC4, 0, 1023UL }; // ADC4 value
 
+	Parameter adc_cal { PRM::ADC_CAL, 0, -1UL }; // Last set ADC calibration point, see AdcCalibration
+	Parameter adc1_eng { PRM::ADC1_ENG, 0, 0xFFFFUL }; // ADC1 calibrated value (mV by default)
+	Parameter adc2_eng { PRM::ADC2_ENG, 0, 0xFFFFUL }; // ADC2 calibrated value (mV by default)
+	Parameter adc3_eng { PRM::ADC3_ENG, 0, 0xFFFFUL }; // ADC3 calibrated value (mV by default)
+	Parameter adc4_eng { PRM::ADC4_ENG, 0, 0xFFFFUL }; // ADC4 calibrated value (mV by default)
+
+	Parameter adc1_fine { PRM::ADC1_FINE, 0, ANALOG::FINE_MAX }; // ADC1 filtered value in 1/64 counts
+	Parameter adc2_fine { PRM::ADC2_FINE, 0, ANALOG::FINE_MAX }; // ADC2 filtered value in 1/64 counts
+	Parameter adc3_fine { PRM::ADC3_FINE, 0, ANALOG::FINE_MAX }; // ADC3 filtered value in 1/64 counts
+	Parameter adc4_fine { PRM::ADC4_FINE, 0, ANALOG::FINE_MAX }; // ADC4 filtered value in 1/64 counts
+
+	Parameter adc_oversample { PRM::ADC_OVERSAMPLE, 0, 3UL }; // ADC extra bits by oversampling 4^n samples per block
+	Parameter adc_ema { PRM::ADC_EMA, 0, 8UL }; // ADC moving average weight 2^-n, 0 is off
+	Parameter adc_settle { PRM::ADC_SETTLE, 0, -1UL }; // Longest measured ADC settling time in microseconds
+
+	Parameter heap_free { PRM::HEAP_FREE, 0, -1UL }; // Free heap in bytes
+	Parameter heap_max_block { PRM::HEAP_MAX_BLOCK, 0, -1UL }; // Largest free heap block in bytes
+	Parameter heap_frag { PRM::HEAP_FRAG, 0, 100UL }; // Heap fragmentation in percent
+
+	Parameter trace_enable { PRM::TRACE_ENABLE, 0, 1UL }; // 1 to record input trace
+	Parameter trace_upload { PRM::TRACE_UPLOAD, 0, 1UL }; // 1 to upload input trace at next refresh
+
+	Parameter mqtt_enable { PRM::MQTT_ENABLE, 0, 1UL }; // 1 to use MQTT besides polling the server
+
+	Parameter tls_handshake { PRM::TLS_HANDSHAKE, 0, -1UL }; // Time of last request opening the TLS connection in milliseconds
+	Parameter tls_heap { PRM::TLS_HEAP, 0, -1UL }; // Heap used by the TLS connection in bytes
+
 	Parameter last_err { PRM::LAST_ERR, 0, -1UL }; // Last error code
 
-	Pump p1 { PINS::PUMP1, &p1_flow_capacity, &p1_flow_request, &pumped1, &ontime }; // Pump 1
-	Pump p2 { PINS::PUMP2, &p2_flow_capacity, &p2_flow_request, &pumped2, &ontime }; // Pump 2
-	Pump p3 { PINS::PUMP3, &p3_flow_capacity, &p3_flow_request, &pumped3, &ontime }; // Pump 3
+	Parameter wifi_conn_time { PRM::WIFI_CONN_TIME, 0, -1UL }; // WiFi connection setup time in milliseconds
+	Parameter wifi_rssi { PRM::WIFI_RSSI, 0, 255UL }; // WiFi signal strength in -dBm
+
+	Parameter sync_debounce { PRM::SYNC_DEBOUNCE, 1, 1000UL }; // Sync input debounce time in milliseconds
+	Parameter pause { PRM::PAUSE, 0, 1UL }; // 1 to pause watering
+
+	Parameter time_now { PRM::TIME, 0, -1UL }; // Unix time in seconds, setting it sets the clock
+	Parameter tz_offset { PRM::TZ_OFFSET, 0, 1560UL }; // Local time offset in minutes east of UTC plus 720
+	Parameter budget_day { PRM::BUDGET_DAY, 0, -1UL }; // Local day number of the daily pumped volumes
+
+	Parameter flow_level_ch { PRM::FLOW_LEVEL_CH, 0, 4UL }; // ADC channel 1..4 of tank level calibrated in cc, 0 is off
+	Parameter pump_current_ch { PRM::PUMP_CURRENT_CH, 0, 4UL }; // ADC channel 1..4 of pump current calibrated in mA, 0 is off
+	Parameter pump_current_min { PRM::PUMP_CURRENT_MIN, 0, 0xFFFFUL }; // Pump current below which it runs dry in mA
+	Parameter pump_current_max { PRM::PUMP_CURRENT_MAX, 0, 0xFFFFUL }; // Pump current above which it is blocked in mA, 0 is no limit
+	Parameter pump_fault { PRM::PUMP_FAULT, 0, -1UL }; // Bit per zone with a pump fault, set 0 to retry
+
+	ZoneOutputs outputs; // Pump or valve outputs of all zones
+
+	Zone zones[ZONE::COUNT] { { 0 }, { 1 }, { 2 } }; // One entry per zone
+
+	AdcFilter filter { &adc_oversample, &adc_ema }; // ADC noise filter
+
+	AdcCalibration calibration; // ADC count to engineering unit conversion
+
+	TraceRecorder trace { &trace_enable }; // Input trace for host replay
+
+	SyncInput sync { PINS::SYNC, &sync_debounce, &trace }; // Sync push button
+
+	WifiConfig wifi; // Known networks and server host
+
+	Clock clock { &tz_offset, &trace }; // Monotonic time base and wall clock
 
 	MachineState();
 
-	bool parseParamGetRequest(WiFiClient * const stream);
+	void begin();
+
+	bool connectWifi();
 
-	bool parseParamSetRequest(WiFiClient * const stream);
+	bool parseParamGetRequest(Stream * const stream);
+
+	bool parseParamSetRequest(Stream * const stream);
 
 	void uploadToServer();
 
 	void downloadFromServer();
 
-	void run(unsigned long now);
+	void beginTls();
+
+	void uploadTrace();
+
+	void beginLocalServer();
+
+	void serveLocalClient(unsigned long now);
+
+	void beginMqtt();
+
+	void serveMqtt(unsigned long now);
+
+	void beginClock();
+
+	void run(uint64_t now);
+
+	bool primeNextPump(uint64_t now);
 
 private:
-	Parameter* params[PRM::_END];
+	friend class Benchmark; // Times the private parsing and packing
+	friend class TraceReplay; // Feeds recorded commands to the parser on a host
+	friend class HostBench; // Times and counts allocations on a host
+
+	Parameter* params[PRM::ID_END] = { };
+
+	// Buffers allocated once, see MEM
+	HTTPClient http; // Server connection, reused between requests
+	WiFiClient plain_net; // Server transport without TLS
+	BearSSL::WiFiClientSecure tls_net; // Server transport with TLS
+	BearSSL::Session tls_session; // Resumed on reconnect to skip full handshake
+	BearSSL::X509List * tls_anchors = nullptr; // From WIFI::tls_trust_anchor
+	bool tls_trusted = false; // Server verification is set up
+	bool tls_opening = false; // Current request opens the TLS connection
+	unsigned long tls_open_start = 0; // Time the opening request began [ms]
+	unsigned long tls_open_heap = 0; // Free heap before the opening request
+	char url[MEM::URL_SIZE]; // Server request url
+	byte packet[MEM::PACKET_SIZE]; // Upload packet
+	char line[MEM::LINE_SIZE]; // Server response line
+
+	WiFiServer lan_server { WIFI::lan_port }; // Local control server
+	WiFiClient lan_client; // Connected local client, if any
+	unsigned long lan_client_heard = 0; // Time of last bytes from local client [ms]
+	byte lan_rx[MEM::LAN_RX_SIZE]; // Request of local client, received so far
+	unsigned short lan_rx_len = 0; // Bytes in lan_rx
+
+	byte running = 0; // Number of running pumps
+	byte next_prime = 0; // Zone to prime next
+
+	bool starts_restored = false; // Saved pump start times applied
+	unsigned long uptime_day = 0; // Days from power on at last daily reset
+	bool quiet = false; // Parse without serial log and pacing, see Benchmark
+
+	unsigned long flow_level_start = 0; // Tank level at pump start [cc]
+	unsigned long flow_last_check = 0; // Time of last flow check [ms]
+
+	WiFiClient mqtt_net; // Broker connection
+	PubSubClient mqtt { mqtt_net }; // MQTT session
+	char mqtt_cmd_topic[MEM::TOPIC_SIZE]; // Topic to receive commands on
+	char mqtt_prm_topic[MEM::TOPIC_SIZE]; // Topic to publish parameters on
+	unsigned long mqtt_last_try = 0; // Time of last connection attempt [ms]
+	unsigned long mqtt_retry = WIFI::MQTT_RETRY; // Wait after a failed attempt [ms]
+	unsigned long mqtt_last_publish = 0; // Time of last change check [ms]
+	bool mqtt_pending = false; // Command received, publish replies
+	unsigned long published[PRM::ID_END] = { }; // Last published values
+
+	bool connectMqtt();
+
+	void onMqttMessage(char * topic, byte * payload, unsigned int length);
+
+	bool beginRequest(const char * const path, const bool add_cid);
+
+	void endRequestTiming();
+
+	bool parseCommandStream(Stream * const source);
+
+	static bool commandComplete(const byte * const cmds, const size_t len);
+
+	unsigned short packFlaggedParams(byte * const buffer,
+			const unsigned short size, bool * const reset_last_err);
 
 	void readADC(prmid_t pid);
 
 	unsigned int remainingTankVolume();
 
-	void printErrorStream(WiFiClient * const stream);
+	void printErrorStream(Stream * const stream);
+
+	void readHeap(prmid_t pid);
+
+	void readClock(prmid_t pid);
+
+	void loadSaved(Parameter * const prm, const prmid_t legacy);
+
+	void rollDay();
+
+	void saveRun(Zone * const zone);
+
+	void restoreStarts(uint64_t now);
+
+	unsigned long readChannel(unsigned long channel);
+
+	void beginFlowCheck(unsigned long now);
+
+	void checkFlow(byte zone, uint64_t now);
+
+	void endFlowCheck(byte zone, unsigned long seconds);
+
+	void flagPumpFault(byte zone, byte err);
+
+	void reportFault(byte err, const char * const err_msg);
 
-	void reportFault(byte err, String err_msg);
+	void reportFault(byte err, const char * const err_msg, unsigned long val);
 };
 
 #endif
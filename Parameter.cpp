@@ -19,15 +19,43 @@ unsigned long Parameter::get() const {
 	return val;
 }
 
+unsigned long Parameter::flash_bytes = 0;
+
 /**
- * Save value to EEPROM. Call EEPROM.begin() first!
+ * Save value to EEPROM. Call EEPROM.begin() first! Flash is only written if
+ * the stored value differs.
  */
 void Parameter::eepromSave() const {
-	EEPROM.write(eeprom_pos + 0, val >> 24);
-	EEPROM.write(eeprom_pos + 1, val >> 16);
-	EEPROM.write(eeprom_pos + 2, val >> 8);
-	EEPROM.write(eeprom_pos + 3, val);
+	if (eepromWrite()) {
+		eepromCommit();
+	}
+}
+
+/**
+ * Write value to the EEPROM buffer without committing it to flash. Returns
+ * true if the stored value changed. Use to save several parameters with one
+ * eepromCommit().
+ */
+bool Parameter::eepromWrite() const {
+	const byte bytes[] = { (byte) (val >> 24), (byte) (val >> 16),
+			(byte) (val >> 8), (byte) val };
+	bool changed = false;
+
+	for (byte k = 0; k < sizeof(bytes); k++) {
+		if (EEPROM.read(eeprom_pos + k) != bytes[k]) {
+			EEPROM.write(eeprom_pos + k, bytes[k]);
+			changed = true;
+		}
+	}
+	return changed;
+}
+
+/**
+ * Commit EEPROM writes to flash.
+ */
+void Parameter::eepromCommit() {
 	EEPROM.commit();	// Commit writes
+	flash_bytes += EEPROM_SIZE; // Commit rewrites the whole EEPROM sector
 }
 
 /**
@@ -41,3 +69,16 @@ void Parameter::eepromLoad() {
 	val |= EEPROM.read(eeprom_pos + 3);
 	set(val);
 }
+
+/**
+ * Returns true if the EEPROM slot was never written, i.e. reads as erased
+ * flash 0xFFFFFFFF. Call EEPROM.begin() first!
+ */
+bool Parameter::eepromErased() const {
+	for (byte k = 0; k < 4; k++) {
+		if (EEPROM.read(eeprom_pos + k) != 0xFF) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -20,6 +20,11 @@ public:
 	 */
 	bool upload = false;
 
+	/*
+	 *  Bytes written to flash by eepromSave() and eepromCommit() since boot
+	 */
+	static unsigned long flash_bytes;
+
 	/**
 	 * Constructor. Value is initialized to the low limit.
 	 *
@@ -39,8 +44,14 @@ public:
 
 	void eepromSave() const;
 
+	bool eepromWrite() const;
+
+	static void eepromCommit();
+
 	void eepromLoad();
 
+	bool eepromErased() const;
+
 private:
 	const prmid_t prm; // Index in parameter array.
 	unsigned long val; // Parameter value.
@@ -1,11 +1,20 @@
 // Do not remove the include below
 #include "Pump.h"
 
+/**
+ * Set output and round runtime parameter.
+ */
+void Pump::attach(ZoneOutputs* const zone_outputs,
+		const Parameter* const ontime_prm) {
+	outputs = zone_outputs;
+	round_runtime = ontime_prm;
+}
+
 /**
  * Returns true if pump is running
  */
 bool Pump::isOn() const {
-	return (digitalRead(p_pin) == HIGH);
+	return outputs->get(zone);
 }
 
 /**
@@ -15,13 +24,25 @@ unsigned long Pump::getPumpedVolume() const {
 	return pumped_vol->get();
 }
 
+/**
+ * Returns the flow rate used for dosing [cc/min]: the measured flow capacity
+ * if there is one, else the configured one.
+ */
+unsigned long Pump::flow() const {
+	return flow_estimate->get() ? flow_estimate->get() : flow_capacity->get();
+}
+
 /**
  * Method starts pump at intervals to deliver the requested flow.
  * If inhibit is true, pump may shut off but not start.
  *
  * tbd Returns true when pump is switched off, i.e.
+ *
+ * @param now Milliseconds from power on, see Clock::update().
+ * @param inhibit True to stop the pump and not start it.
+ * @param max_vol Largest volume to deliver per round [cc].
  */
-void Pump::run(unsigned long now, bool inhibit) {
+void Pump::run(uint64_t now, bool inhibit, unsigned long max_vol) {
 	unsigned long elapsed_s;	// Time elapsed since last start of pump [ms]
 	unsigned int delivered_vol; // Delivered pump volume this round  [cc]
 	unsigned int v_accum;		// Accumulated need to pump [cc].
@@ -34,38 +55,40 @@ void Pump::run(unsigned long now, bool inhibit) {
 
 		// Stop pump if it is inhibited or runtime seconds has elapsed.
 		if (inhibit || elapsed_s >= runtime) {
-			Serial.print("\nTurn off pin ");
-			Serial.print(p_pin, DEC);
+			Serial.print("\nTurn off zone ");
+			Serial.print(zone, DEC);
 			Serial.print(", elapsed [s]=");
 			Serial.print(elapsed_s, DEC);
 
 			// Turn off pump
-			digitalWrite(p_pin, LOW);
+			outputs->set(zone, false);
 
-			// Update pumped volume
-			delivered_vol = (elapsed_s * flow_capacity->get()) / 60;
+			// Update pumped volume, saved by the caller
+			delivered_vol = (elapsed_s * flow()) / 60;
 			pumped_vol->set(pumped_vol->get() + delivered_vol);
-			pumped_vol->eepromSave();
 		}
 
 	} else {
 		// Pump is stopped...
 
 		v_accum = (elapsed_s * flow_request->get()) / 86400;
-		v_round = (round_runtime->get() * flow_capacity->get()) / 60;
+		v_round = (round_runtime->get() * flow()) / 60;
+		if (v_accum > max_vol) {
+			v_accum = max_vol;
+		}
 
 		// Start pump if not inhibited and accumulated need exceeds the round
 		// volume.
 		if (!inhibit && v_accum > v_round) {
-			Serial.print("\nTurn on pin ");
-			Serial.print(p_pin, DEC);
+			Serial.print("\nTurn on zone ");
+			Serial.print(zone, DEC);
 			Serial.print(", runtime [s]=");
 			Serial.print(runtime, DEC);
 			Serial.print(", volume=");
 			Serial.print(v_accum, DEC);
 
 			// Turn on pump
-			digitalWrite(p_pin, HIGH);
+			outputs->set(zone, true);
 
 			// Updated time of last pump start.
 			last_switch_on = now;
@@ -78,6 +101,26 @@ void Pump::run(unsigned long now, bool inhibit) {
 
 }
 
+/**
+ * Start pump for a number of seconds regardless of requested flow, e.g. to
+ * fill the tubing. run() stops the pump and accounts the pumped volume as
+ * for a normal round.
+ */
+void Pump::prime(uint64_t now, unsigned long seconds) {
+	if (isOn()) {
+		return;
+	}
+
+	Serial.print("\nPrime zone ");
+	Serial.print(zone, DEC);
+	Serial.print(", runtime [s]=");
+	Serial.print(seconds, DEC);
+
+	outputs->set(zone, true);
+	last_switch_on = now;
+	runtime = seconds;
+}
+
 /***************
  * Private
  ***************/
@@ -88,5 +131,5 @@ void Pump::run(unsigned long now, bool inhibit) {
  * @param v Volume in cc.
  */
 unsigned int Pump::getPumpTime(unsigned int vol) const {
-	return (vol * 60) / flow_capacity->get();
+	return (vol * 60) / flow();
 }
@@ -3,39 +3,48 @@
 
 #include "Arduino.h"
 #include "Parameter.h"
+#include "ZoneOutputs.h"
 
 class Pump {
 private:
-	const uint8_t p_pin;
+	const byte zone;
+	ZoneOutputs * outputs;
 
 public:
 	Parameter const * const flow_capacity;	// Pump flow capacity [cc/min]
+	Parameter const * const flow_estimate;	// Measured flow capacity [cc/min], 0 if none
 	Parameter const * const flow_request;	// Requested volume [cc/day]
 	Parameter * pumped_vol;					// Pumped volume [cc]
-	Parameter const * const round_runtime;	// Pump runtime per round [s].
-	unsigned long last_switch_on;			// Time of last pump start [ms].
+	Parameter const * round_runtime;		// Pump runtime per round [s].
+	uint64_t last_switch_on;				// Time of last pump start [ms].
 	unsigned long runtime;					// Pump run time [s].
 
 	/**
-	 * Constructor
+	 * Constructor. Call attach() before running the pump.
 	 */
-	Pump(const byte pin, //
+	Pump(const byte zone_index, //
 			const Parameter* const flow_capacity_prm, //
+			const Parameter* const flow_estimate_prm, //
 			const Parameter* const flow_request_prm, //
-			Parameter* const accum_vol_prm, //
-			const Parameter* const ontime_prm) :
-			p_pin(pin), flow_capacity(flow_capacity_prm), flow_request(
+			Parameter* const accum_vol_prm) :
+			zone(zone_index), outputs(nullptr), flow_capacity(
+					flow_capacity_prm), flow_estimate(flow_estimate_prm), flow_request(
 					flow_request_prm), pumped_vol(accum_vol_prm), round_runtime(
-					ontime_prm), last_switch_on(-1UL), runtime(0) {
-		pinMode(pin, OUTPUT);
-		digitalWrite(pin, LOW);
+					nullptr), last_switch_on(0), runtime(0) {
 	}
 
+	void attach(ZoneOutputs* const zone_outputs,
+			const Parameter* const ontime_prm);
+
 	bool isOn() const;
 
 	unsigned long getPumpedVolume() const;
 
-	void run(unsigned long now, bool inhibit);
+	unsigned long flow() const;
+
+	void run(uint64_t now, bool inhibit, unsigned long max_vol);
+
+	void prime(uint64_t now, unsigned long seconds);
 
 private:
 
@@ -0,0 +1,79 @@
+// Do not remove the include below
+#include "SyncInput.h"
+
+/**
+ * Queue the time of an edge. Call from the pin interrupt on CHANGE. Edges are
+ * dropped when the queue is full, the settled pin level is read in poll()
+ * anyway.
+ */
+void ICACHE_RAM_ATTR SyncInput::onEdge() {
+	byte next = (head + 1) & (QUEUE_SIZE - 1);
+	if (next != tail) {
+		edge_time[head] = millis();
+		head = next;
+	}
+}
+
+/**
+ * Decode queued edges. Returns an EVT:: event id, EVT::NONE if nothing
+ * happened.
+ *
+ * A short press is reported once no second press followed within
+ * EVT::DOUBLE_PRESS_GAP. A long press is reported as soon as the input has
+ * been held for EVT::LONG_PRESS_TIME.
+ *
+ * @param now Milliseconds from power on taken at start of each program loop.
+ */
+evtid_t SyncInput::poll(unsigned long now) {
+	bool level;
+
+	// Drain edges. A burst of bounces counts from its first edge.
+	while (tail != head) {
+		if (!bouncing) {
+			bouncing = true;
+			burst_start = edge_time[tail];
+		}
+		last_edge = edge_time[tail];
+		tail = (tail + 1) & (QUEUE_SIZE - 1);
+		if (trace != nullptr) {
+			trace->record(TRC::SYNC_EDGE);
+		}
+	}
+
+	// Sample the pin when it has been quiet for the debounce time.
+	if (bouncing && now - last_edge >= debounce->get()) {
+		bouncing = false;
+		level = (digitalRead(p_pin) == LOW);
+
+		if (level && !pressed) {
+			press_time = burst_start;
+			long_sent = false;
+
+		} else if (!level && pressed) {
+			release_time = burst_start;
+			if (!long_sent) {
+				++clicks;
+			}
+		}
+		pressed = level;
+	}
+
+	if (pressed && !long_sent && now - press_time >= EVT::LONG_PRESS_TIME) {
+		long_sent = true;
+		clicks = 0;
+		return EVT::LONG_PRESS;
+	}
+
+	if (clicks >= 2) {
+		clicks = 0;
+		return EVT::DOUBLE_PRESS;
+	}
+
+	if (clicks == 1 && !pressed && !bouncing
+			&& now - release_time > EVT::DOUBLE_PRESS_GAP) {
+		clicks = 0;
+		return EVT::SHORT_PRESS;
+	}
+
+	return EVT::NONE;
+}
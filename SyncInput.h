@@ -0,0 +1,57 @@
+#ifndef SyncInput_H_
+#define SyncInput_H_
+
+#include "Arduino.h"
+#include "Parameter.h"
+#include "TraceRecorder.h"
+
+/**
+ * Debounced push button on an active low digital input.
+ *
+ * The interrupt handler only queues edge timestamps. poll() drains the queue
+ * from the program loop, waits until the input has been quiet for the
+ * debounce time and then decodes short, long and double presses into EVT::
+ * events.
+ */
+class SyncInput {
+private:
+	static const byte QUEUE_SIZE = 16; // Power of two
+
+	const uint8_t p_pin;
+
+	volatile unsigned long edge_time[QUEUE_SIZE]; // Queued edge times [ms]
+	volatile byte head;		// Next queue position to write (ISR)
+	byte tail;				// Next queue position to read
+
+	bool bouncing;			// Edges seen, waiting for input to settle
+	unsigned long burst_start;	// Time of first edge in burst [ms]
+	unsigned long last_edge;	// Time of latest edge [ms]
+
+	TraceRecorder * const trace;	// Records edges, may be nullptr
+
+	bool pressed;			// Debounced state
+	bool long_sent;			// Long press already reported
+	byte clicks;			// Short presses waiting to be decoded
+	unsigned long press_time;	// Time of last press [ms]
+	unsigned long release_time;	// Time of last release [ms]
+
+public:
+	Parameter const * const debounce;	// Debounce time [ms]
+
+	/**
+	 * Constructor
+	 */
+	SyncInput(const byte pin, const Parameter* const debounce_prm,
+			TraceRecorder* const trace_rec) :
+			p_pin(pin), head(0), tail(0), bouncing(false), burst_start(0), //
+			last_edge(0), trace(trace_rec), pressed(false), long_sent(false), //
+			clicks(0), press_time(0), release_time(0), debounce(debounce_prm) {
+	}
+
+	void onEdge();
+
+	evtid_t poll(unsigned long now);
+
+};
+
+#endif
@@ -0,0 +1,157 @@
+// Do not remove the include below
+#include "TraceRecorder.h"
+
+/**
+ * Reverse bytes from first up to, not including, last.
+ */
+static void reverseBytes(byte * first, byte * last) {
+	byte b;
+	while (first < last && first < --last) {
+		b = *first;
+		*first++ = *last;
+		*last = b;
+	}
+}
+
+/**
+ * Append a record with payload if recording is enabled. Oldest records are
+ * dropped to make room.
+ *
+ * @param type Record type, see TRC.
+ * @param payload Payload bytes.
+ * @param len Number of payload bytes, must match the type.
+ */
+void TraceRecorder::record(trcid_t type, const byte * const payload, byte len) {
+	byte header[6];
+	byte n = 0;
+	byte b;
+	unsigned long now;
+	unsigned long dt;
+
+	if (!enable->get() || type == TRC::NONE || type >= TRC::_END) {
+		return;
+	}
+	if (type == TRC::RX ?
+			len < 1 || len != 1 + (payload[0] & ~TRC::RX_LAST)
+					|| len > 1 + TRC::RX_MAX :
+			len != payloadLength(type)) {
+		return;
+	}
+
+	now = millis();
+	dt = now - last_time;
+	last_time = now;
+
+	// Type and varint time delta
+	header[n++] = type;
+	do {
+		b = dt & 0x7F;
+		dt >>= 7;
+		header[n++] = dt ? b | 0x80 : b;
+	} while (dt);
+
+	while (sizeof(buf) - used < n + len) {
+		dropOldest();
+	}
+
+	for (byte k = 0; k < n; k++) {
+		push(header[k]);
+	}
+	for (byte k = 0; k < len; k++) {
+		push(payload[k]);
+	}
+}
+
+/**
+ * Append a record without payload.
+ */
+void TraceRecorder::record(trcid_t type) {
+	record(type, nullptr, 0);
+}
+
+/**
+ * Rotate the ring buffer in place so the oldest record comes first and
+ * return it. The trace is size() bytes long.
+ */
+const byte * TraceRecorder::linearize() {
+	if (tail != 0) {
+		reverseBytes(buf, buf + tail);
+		reverseBytes(buf + tail, buf + sizeof(buf));
+		reverseBytes(buf, buf + sizeof(buf));
+		tail = 0;
+		head = used % sizeof(buf);
+	}
+	return buf;
+}
+
+/**
+ * Returns number of bytes recorded.
+ */
+unsigned short TraceRecorder::size() const {
+	return used;
+}
+
+/**
+ * Drop all records.
+ */
+void TraceRecorder::clear() {
+	head = 0;
+	tail = 0;
+	used = 0;
+}
+
+/***************
+ * Private
+ ***************/
+
+/**
+ * Write one byte at head. Caller makes sure there is room.
+ */
+void TraceRecorder::push(byte b) {
+	buf[head] = b;
+	head = (head + 1) % sizeof(buf);
+	++used;
+}
+
+/**
+ * Drop the oldest record.
+ */
+void TraceRecorder::dropOldest() {
+	unsigned short n = 1;
+
+	if (used == 0) {
+		return;
+	}
+
+	// Skip varint time delta
+	while (buf[(tail + n) % sizeof(buf)] & 0x80) {
+		++n;
+	}
+	++n;
+
+	if (buf[tail] == TRC::RX) {
+		n += 1 + (buf[(tail + n) % sizeof(buf)] & ~TRC::RX_LAST);
+	} else {
+		n += payloadLength(buf[tail]);
+	}
+
+	tail = (tail + n) % sizeof(buf);
+	used = (n < used) ? used - n : 0;
+}
+
+/**
+ * Returns the payload length of a record type. RX records have a variable
+ * length given by their first payload byte.
+ */
+byte TraceRecorder::payloadLength(trcid_t type) {
+	switch (type) {
+	case TRC::ADC:
+		return 3;
+	case TRC::PUMP:
+		return 1;
+	case TRC::CLOCK:
+		return 4;
+	default:
+		return 0;
+	}
+}
@@ -0,0 +1,51 @@
+#ifndef TraceRecorder_H_
+#define TraceRecorder_H_
+
+#include "consts_and_types.h"
+#include "Parameter.h"
+
+/**
+ * Records the inputs driving MachineState to a RAM ring buffer so field
+ * problems can be replayed on a host. Records are described in TRC. The
+ * oldest records are dropped when the buffer is full.
+ *
+ * Sync edges are taken from SyncInput::poll() and not from the interrupt, so
+ * record() must only be called from the program loop. Received command bytes
+ * are recorded by TraceStream, also when they are malformed.
+ */
+class TraceRecorder {
+public:
+	Parameter const * const enable;	// 1 to record
+
+	/**
+	 * Constructor
+	 */
+	TraceRecorder(const Parameter* const enable_prm) :
+			enable(enable_prm), head(0), tail(0), used(0), last_time(0) {
+	}
+
+	void record(trcid_t type, const byte * const payload, byte len);
+
+	void record(trcid_t type);
+
+	const byte * linearize();
+
+	unsigned short size() const;
+
+	void clear();
+
+private:
+	byte buf[MEM::TRACE_SIZE];
+	unsigned short head;	// Next position to write
+	unsigned short tail;	// Oldest record
+	unsigned short used;	// Bytes in use
+	unsigned long last_time;	// Time of last record [ms]
+
+	void push(byte b);
+
+	void dropOldest();
+
+	static byte payloadLength(trcid_t type);
+};
+
+#endif
@@ -0,0 +1,63 @@
+// Do not remove the include below
+#include "TraceStream.h"
+
+/**
+ * Returns number of bytes available from the source.
+ */
+int TraceStream::available() {
+	return source->available();
+}
+
+/**
+ * Returns next byte from the source or -1. The byte is recorded.
+ */
+int TraceStream::read() {
+	int b = source->read();
+
+	if (b >= 0) {
+		if (used == TRC::RX_MAX) {
+			recordChunk(false);
+		}
+		chunk[1 + used++] = b;
+	}
+	return b;
+}
+
+/**
+ * Returns next byte from the source without consuming it, or -1.
+ */
+int TraceStream::peek() {
+	return source->peek();
+}
+
+/**
+ * Writes are not supported. Returns 0.
+ */
+size_t TraceStream::write(uint8_t b) {
+	(void) b;
+	return 0;
+}
+
+/**
+ * Record the remaining bytes as the last record of the stream. Further calls
+ * do nothing.
+ */
+void TraceStream::end() {
+	if (!ended) {
+		ended = true;
+		recordChunk(true);
+	}
+}
+
+/***************
+ * Private
+ ***************/
+
+/**
+ * Record the bytes read since the last record.
+ */
+void TraceStream::recordChunk(bool last) {
+	chunk[0] = used | (last ? TRC::RX_LAST : 0);
+	trace->record(TRC::RX, chunk, 1 + used);
+	used = 0;
+}
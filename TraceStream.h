@@ -0,0 +1,48 @@
+#ifndef TraceStream_H_
+#define TraceStream_H_
+
+#include "Arduino.h"
+#include "TraceRecorder.h"
+
+/**
+ * Stream which passes reads through from another stream and records the
+ * bytes read to the input trace in TRC::RX records. Parsers read through it
+ * so malformed or truncated input is kept for replay. The last record is
+ * made by end(), or when the stream is destroyed.
+ */
+class TraceStream: public Stream {
+private:
+	Stream * const source;
+	TraceRecorder * const trace;
+	byte chunk[1 + TRC::RX_MAX]; // Length byte and bytes not yet recorded
+	byte used;
+	bool ended;
+
+public:
+	/**
+	 * Constructor. The read timeout is taken from the source.
+	 */
+	TraceStream(Stream* const source_stream, TraceRecorder* const trace_rec) :
+			source(source_stream), trace(trace_rec), used(0), ended(false) {
+		setTimeout(source->getTimeout());
+	}
+
+	~TraceStream() {
+		end();
+	}
+
+	int available() override;
+
+	int read() override;
+
+	int peek() override;
+
+	size_t write(uint8_t b) override;
+
+	void end();
+
+private:
+	void recordChunk(bool last);
+};
+
+#endif
@@ -0,0 +1,311 @@
+// Do not remove the include below
+#include "WifiConfig.h"
+
+#include <EEPROM.h>
+
+/**
+ * Load the store from EEPROM. An empty store is initialized with the default
+ * network and host in consts_and_types.h. Call EEPROM.begin() first!
+ */
+void WifiConfig::load() {
+	EEPROM.get(EEPROM_WIFI_POS, store);
+
+	if (store.magic != MAGIC) {
+		memset(&store, 0, sizeof(store));
+		store.magic = MAGIC;
+		store.last = 0;
+		strncpy(store.host, WIFI::host, sizeof(store.host) - 1);
+		strncpy(store.networks[0].ssid, WIFI::ssid,
+				sizeof(store.networks[0].ssid) - 1);
+		strncpy(store.networks[0].password, WIFI::password,
+				sizeof(store.networks[0].password) - 1);
+		save();
+	}
+
+	// Never trust strings read back from EEPROM to be terminated
+	store.host[sizeof(store.host) - 1] = '\0';
+	for (byte k = 0; k < MAX_NETWORKS; k++) {
+		Network * const n = &store.networks[k];
+		n->ssid[sizeof(n->ssid) - 1] = '\0';
+		n->password[sizeof(n->password) - 1] = '\0';
+	}
+	if (store.last >= MAX_NETWORKS) {
+		store.last = NO_NETWORK;
+	}
+
+	// First connection and roam scan need not wait
+	last_fail = millis() - WIFI::RECONNECT_INTERVAL;
+	last_scan = millis() - WIFI::ROAM_SCAN_INTERVAL;
+}
+
+/**
+ * Keep the connection up and move to a stronger known access point when the
+ * signal is weak. Returns true when connected. Call from the program loop, it
+ * never blocks.
+ *
+ * When the link is down the last used network is joined with its cached
+ * channel and BSSID. If that times out, networks are scanned and the
+ * strongest known one is joined. After a failed attempt the next waits
+ * WIFI::RECONNECT_INTERVAL. When connected with RSSI below WIFI::ROAM_RSSI a
+ * scan is made at most every WIFI::ROAM_SCAN_INTERVAL.
+ */
+bool WifiConfig::roam() {
+	unsigned long now = millis();
+	bool connected = (WiFi.status() == WL_CONNECTED);
+	int best_rssi;
+	int8_t slot;
+
+	switch (state) {
+	case JOINING:
+		if (connected) {
+			joined(now);
+			return true;
+		}
+		if (now - since < (joining_fast ?
+				WIFI::FAST_CONNECT_TIMEOUT : WIFI::CONNECT_TIMEOUT)) {
+			return false;
+		}
+		WiFi.disconnect();
+		state = IDLE;
+		if (joining_fast) {
+			startScan(now); // Cached network failed, look for others
+		} else {
+			last_fail = now;
+		}
+		return false;
+
+	case SCANNING:
+		slot = strongestKnown(WiFi.scanComplete(), &best_rssi);
+		if (state == SCANNING) {
+			return connected; // Scan still running
+		}
+		if (connected) {
+			if (slot == NO_NETWORK || best_rssi < WiFi.RSSI() + WIFI::ROAM_MARGIN
+					|| memcmp(store.networks[slot].bssid, WiFi.BSSID(), 6)
+							== 0) {
+				return true;
+			}
+			Serial.print("\nRoam to ");
+			Serial.print(store.networks[slot].ssid);
+			Serial.print(", rssi=");
+			Serial.print(best_rssi, DEC);
+			WiFi.disconnect();
+			attempt_start = now;
+		}
+		if (!startJoin(slot, false, now)) {
+			last_fail = now;
+		}
+		return false;
+
+	case IDLE:
+	default:
+		if (connected) {
+			if (WiFi.RSSI() < WIFI::ROAM_RSSI
+					&& now - last_scan >= WIFI::ROAM_SCAN_INTERVAL) {
+				startScan(now);
+			}
+			return true;
+		}
+		if (now - last_fail < WIFI::RECONNECT_INTERVAL) {
+			return false;
+		}
+		attempt_start = now;
+		WiFi.persistent(false); // Credentials are kept in our own store
+		WiFi.mode(WIFI_STA);
+		if (!startJoin(store.last, true, now)) {
+			startScan(now);
+		}
+		return false;
+	}
+}
+
+/**
+ * Handle a provisioning line, e.g. read from the serial port. Returns false
+ * if the line is not a provisioning command. The line is modified.
+ *
+ * An SSID with spaces is given in double quotes, the password is the rest of
+ * the line and may hold spaces.
+ */
+bool WifiConfig::provision(char * const line) {
+	char * cmd;
+	char * arg;
+	char * ssid;
+	char * password;
+	int slot;
+
+	cmd = strtok(line, " \r");
+	if (cmd == nullptr) {
+		return false;
+	}
+
+	if (strcmp(cmd, "wifi") == 0) {
+		arg = strtok(nullptr, " \r");
+		slot = arg ? atoi(arg) : -1;
+		if (slot < 0 || slot >= MAX_NETWORKS) {
+			Serial.print("\n**Bad slot");
+			return true;
+		}
+
+		// SSID, quoted if it holds spaces, and the rest of the line
+		ssid = strtok(nullptr, "\r\n");
+		password = nullptr;
+		while (ssid != nullptr && *ssid == ' ') {
+			++ssid;
+		}
+		if (ssid != nullptr && *ssid == '"') {
+			password = strchr(++ssid, '"');
+			if (password == nullptr) {
+				Serial.print("\n**Bad ssid");
+				return true;
+			}
+			*password++ = '\0';
+			if (*password == ' ') {
+				++password;
+			}
+		} else if (ssid != nullptr) {
+			password = strchr(ssid, ' ');
+			if (password != nullptr) {
+				*password++ = '\0';
+			}
+		}
+
+		Network * const n = &store.networks[slot];
+		memset(n, 0, sizeof(Network));
+		if (ssid != nullptr) {
+			strncpy(n->ssid, ssid, sizeof(n->ssid) - 1);
+		}
+		if (password != nullptr) {
+			strncpy(n->password, password, sizeof(n->password) - 1);
+		}
+
+	} else if (strcmp(cmd, "host") == 0) {
+		arg = strtok(nullptr, " \r");
+		if (arg == nullptr) {
+			Serial.print("\n**Bad host");
+			return true;
+		}
+		memset(store.host, 0, sizeof(store.host));
+		strncpy(store.host, arg, sizeof(store.host) - 1);
+
+	} else {
+		return false;
+	}
+
+	save();
+	Serial.print("\nSaved");
+	return true;
+}
+
+/**
+ * Returns the server host name.
+ */
+const char * WifiConfig::host() const {
+	return store.host;
+}
+
+/***************
+ * Private
+ ***************/
+
+/**
+ * Save store to EEPROM.
+ */
+void WifiConfig::save() {
+	EEPROM.put(EEPROM_WIFI_POS, store);
+	EEPROM.commit();	// Commit writes
+}
+
+/**
+ * Begin joining the network in slot. If fast is true, the cached channel and
+ * BSSID are used with a short timeout. Returns false if the slot can not be
+ * joined.
+ */
+bool WifiConfig::startJoin(int8_t slot, bool fast, unsigned long now) {
+	if (slot == NO_NETWORK) {
+		return false;
+	}
+
+	Network * const n = &store.networks[slot];
+	if (n->ssid[0] == '\0' || (fast && n->channel == 0)) {
+		return false;
+	}
+
+	if (n->channel != 0) {
+		WiFi.begin(n->ssid, n->password, n->channel, n->bssid);
+	} else {
+		WiFi.begin(n->ssid, n->password);
+	}
+	state = JOINING;
+	joining = slot;
+	joining_fast = fast;
+	since = now;
+	return true;
+}
+
+/**
+ * Begin an asynchronous scan for networks.
+ */
+void WifiConfig::startScan(unsigned long now) {
+	WiFi.scanNetworks(true);
+	state = SCANNING;
+	last_scan = now;
+}
+
+/**
+ * A join completed. Cache the channel and BSSID of the network.
+ */
+void WifiConfig::joined(unsigned long now) {
+	Network * const n = &store.networks[joining];
+	bool changed;
+
+	state = IDLE;
+	connect_time = now - attempt_start;
+
+	// Only write EEPROM when something changed to save flash wear. A scan
+	// may already have updated the cache in RAM.
+	changed = !joining_fast || store.last != joining
+			|| n->channel != WiFi.channel()
+			|| memcmp(n->bssid, WiFi.BSSID(), 6) != 0;
+	if (changed) {
+		store.last = joining;
+		n->channel = WiFi.channel();
+		memcpy(n->bssid, WiFi.BSSID(), 6);
+		save();
+	}
+}
+
+/**
+ * Collect the result of an asynchronous scan. Returns the slot of the known
+ * network with strongest signal and updates its channel and BSSID, or
+ * NO_NETWORK if none is in range. The state is left as SCANNING while the
+ * scan runs.
+ *
+ * @param count Result of WiFi.scanComplete().
+ * @param rssi Set to the signal strength of the returned network [dBm].
+ */
+int8_t WifiConfig::strongestKnown(int count, int * const rssi) {
+	int8_t best = NO_NETWORK;
+
+	*rssi = -1000;
+	if (count == WIFI_SCAN_RUNNING) {
+		return NO_NETWORK;
+	}
+
+	state = IDLE;
+	last_scan = millis();
+	for (int i = 0; i < count; i++) {
+		for (int8_t k = 0; k < MAX_NETWORKS; k++) {
+			Network * const n = &store.networks[k];
+			if (n->ssid[0] == '\0' || WiFi.SSID(i) != n->ssid
+					|| WiFi.RSSI(i) <= *rssi) {
+				continue;
+			}
+			best = k;
+			*rssi = WiFi.RSSI(i);
+			n->channel = WiFi.channel(i);
+			memcpy(n->bssid, WiFi.BSSID(i), 6);
+		}
+	}
+	WiFi.scanDelete();
+	return best;
+}
@@ -0,0 +1,79 @@
+#ifndef WifiConfig_H_
+#define WifiConfig_H_
+
+#include <ESP8266WiFi.h>
+#include "consts_and_types.h"
+
+/**
+ * Store of WiFi networks and server host kept in EEPROM at EEPROM_WIFI_POS.
+ *
+ * Connecting first tries the last used network with its cached channel and
+ * BSSID which skips the scan. Otherwise networks in range are scanned and the
+ * known one with the strongest signal is joined. Joins and scans run in the
+ * background, roam() only checks on them, so the program loop is never
+ * blocked.
+ *
+ * Networks are provisioned, e.g. from the serial port, with lines like
+ * - "wifi <slot> <ssid> <password>" : Store network in slot 0..3, the
+ *   password is the rest of the line and an SSID with spaces is quoted
+ * - "wifi <slot>"                   : Clear slot
+ * - "host <name>"                   : Set server host
+ */
+class WifiConfig {
+public:
+	static const uint8_t MAX_NETWORKS = 4;
+
+	unsigned long connect_time = 0; // Duration of last connect [ms]
+
+	void load();
+
+	bool roam();
+
+	bool provision(char * const line);
+
+	const char * host() const;
+
+private:
+	static const uint8_t MAGIC = 0xA5;
+	static const int8_t NO_NETWORK = -1;
+
+	enum State : uint8_t {
+		IDLE,		// Connected, or waiting to retry
+		JOINING,	// Waiting for a join to complete
+		SCANNING	// Waiting for an asynchronous scan
+	};
+
+	struct Network {
+		char ssid[33];
+		char password[65];
+		uint8_t channel; // Cached channel, 0 if unknown
+		uint8_t bssid[6]; // Cached access point MAC
+	};
+
+	struct Store {
+		uint8_t magic;
+		int8_t last; // Slot of last used network
+		char host[48];
+		Network networks[MAX_NETWORKS];
+	} store;
+
+	State state = IDLE;
+	int8_t joining = NO_NETWORK;	// Slot being joined
+	bool joining_fast = false;		// Join uses the cached channel and BSSID
+	unsigned long since = 0;		// Start of current join [ms]
+	unsigned long attempt_start = 0;	// Start of connection attempt [ms]
+	unsigned long last_scan = 0;	// End of last scan [ms]
+	unsigned long last_fail = 0;	// Time of last failed attempt [ms]
+
+	void save();
+
+	bool startJoin(int8_t slot, bool fast, unsigned long now);
+
+	void startScan(unsigned long now);
+
+	void joined(unsigned long now);
+
+	int8_t strongestKnown(int count, int * const rssi);
+};
+
+#endif
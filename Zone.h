@@ -0,0 +1,82 @@
+#ifndef Zone_H_
+#define Zone_H_
+
+#include "consts_and_types.h"
+#include "FlowEstimator.h"
+#include "Parameter.h"
+#include "Pump.h"
+
+/**
+ * A watering zone with its parameters and pump. Parameter ids are allocated
+ * from the zone index, see PRM::zoneId().
+ */
+class Zone {
+public:
+	Parameter flow_capacity; // Pump flow capacity cc/min
+	Parameter flow_request; // Requested flow in cc per day
+	Parameter pumped_vol; // Pumped volume in cc
+	Parameter window_start; // Watering window start in minutes of local day
+	Parameter window_end; // Watering window end in minutes of local day
+	Parameter daily_budget; // Largest volume per local day in cc, 0 is no limit
+	Parameter pumped_today; // Volume pumped this local day in cc
+	Parameter last_start; // Unix time of last pump start in seconds
+	Parameter flow_estimate; // Flow capacity measured from the tank level in cc/min, 0 until measured
+
+	Pump pump;
+
+	FlowEstimator flow; // Refines flow_estimate from measured runs
+
+	/**
+	 * Constructor
+	 *
+	 * @param index Zone index 0 to ZONE::COUNT - 1.
+	 */
+	Zone(const byte index) :
+			flow_capacity { PRM::zoneId(index, PRM::Z_FLOW_CAPACITY), 1, 1000UL }, //
+			flow_request { PRM::zoneId(index, PRM::Z_FLOW_REQUEST), 0, 1000000UL }, //
+			pumped_vol { PRM::zoneId(index, PRM::Z_PUMPED_VOL), 0, -1UL }, //
+			window_start { PRM::zoneId(index, PRM::Z_WINDOW_START), 0, 1440UL }, //
+			window_end { PRM::zoneId(index, PRM::Z_WINDOW_END), 0, 1440UL }, //
+			daily_budget { PRM::zoneId(index, PRM::Z_DAILY_BUDGET), 0, -1UL }, //
+			pumped_today { PRM::zoneId(index, PRM::Z_PUMPED_TODAY), 0, -1UL }, //
+			last_start { PRM::zoneId(index, PRM::Z_LAST_START), 0, -1UL }, //
+			flow_estimate { PRM::zoneId(index, PRM::Z_FLOW_ESTIMATE), 0, 1000UL }, //
+			pump { index, &flow_capacity, &flow_estimate, &flow_request,
+					&pumped_vol } {
+	}
+
+	/**
+	 * Returns true if minute of local day is inside the watering window. The
+	 * window may wrap past midnight and is always open if start equals end.
+	 */
+	bool windowOpen(unsigned int minute) const {
+		unsigned long start = window_start.get();
+		unsigned long end = window_end.get();
+
+		if (start == end) {
+			return true;
+		}
+		if (start < end) {
+			return minute >= start && minute < end;
+		}
+		return minute >= start || minute < end;
+	}
+
+	/**
+	 * Returns volume left of the daily budget [cc], -1UL if there is no limit.
+	 */
+	unsigned long budgetLeft() const {
+		unsigned long budget = daily_budget.get();
+
+		if (budget == 0) {
+			return -1UL;
+		}
+		return (pumped_today.get() < budget) ? budget - pumped_today.get() : 0;
+	}
+
+	// The pump points at the parameters, so a zone must not be copied.
+	Zone(const Zone&) = delete;
+	Zone& operator=(const Zone&) = delete;
+};
+
+#endif
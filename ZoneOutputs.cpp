@@ -0,0 +1,66 @@
+// Do not remove the include below
+#include "ZoneOutputs.h"
+
+/**
+ * Set up pins and switch all outputs off.
+ */
+void ZoneOutputs::begin() {
+	for (byte k = 0; k < ZONE::GPIO_COUNT && k < ZONE::COUNT; k++) {
+		pinMode(ZONE::GPIO[k], OUTPUT);
+		digitalWrite(ZONE::GPIO[k], LOW);
+	}
+
+	if (SR_COUNT > 0) {
+		pinMode(PINS::SR_DATA, OUTPUT);
+		pinMode(PINS::SR_CLOCK, OUTPUT);
+		pinMode(PINS::SR_LATCH, OUTPUT);
+		digitalWrite(PINS::SR_CLOCK, LOW);
+		shiftOutAll();
+	}
+}
+
+/**
+ * Switch output of zone on or off.
+ */
+void ZoneOutputs::set(byte zone, bool on) {
+	if (zone >= ZONE::COUNT || get(zone) == on) {
+		return;
+	}
+
+	if (on) {
+		state[zone >> 3] |= 1 << (zone & 7);
+	} else {
+		state[zone >> 3] &= ~(1 << (zone & 7));
+	}
+
+	if (zone < ZONE::GPIO_COUNT) {
+		digitalWrite(ZONE::GPIO[zone], on ? HIGH : LOW);
+	} else {
+		shiftOutAll();
+	}
+}
+
+/**
+ * Returns true if output of zone is on.
+ */
+bool ZoneOutputs::get(byte zone) const {
+	return zone < ZONE::COUNT && (state[zone >> 3] >> (zone & 7)) & 1;
+}
+
+/***************
+ * Private
+ ***************/
+
+/**
+ * Shift out the state of all shift register zones, last zone first, and
+ * latch them.
+ */
+void ZoneOutputs::shiftOutAll() {
+	digitalWrite(PINS::SR_LATCH, LOW);
+	for (byte k = ZONE::COUNT; k-- > ZONE::GPIO_COUNT;) {
+		digitalWrite(PINS::SR_DATA, get(k) ? HIGH : LOW);
+		digitalWrite(PINS::SR_CLOCK, HIGH);
+		digitalWrite(PINS::SR_CLOCK, LOW);
+	}
+	digitalWrite(PINS::SR_LATCH, HIGH);
+}
@@ -0,0 +1,28 @@
+#ifndef ZoneOutputs_H_
+#define ZoneOutputs_H_
+
+#include "consts_and_types.h"
+
+/**
+ * Pump or valve outputs of all zones. Zones below ZONE::GPIO_COUNT drive the
+ * pump pins directly, the rest are bits in a chain of 74HC595 shift registers.
+ * The state of each output is cached so reading it is cheap.
+ */
+class ZoneOutputs {
+public:
+	void begin();
+
+	void set(byte zone, bool on);
+
+	bool get(byte zone) const;
+
+private:
+	static const byte SR_COUNT = (ZONE::COUNT > ZONE::GPIO_COUNT) ?
+			ZONE::COUNT - ZONE::GPIO_COUNT : 0;
+
+	byte state[(ZONE::COUNT + 7) / 8] = { }; // One bit per zone
+
+	void shiftOutAll();
+};
+
+#endif
@@ -22,12 +22,25 @@ typedef uint8_t prmid_t;
  */
 typedef uint8_t actid_t;
 
+/**
+ * Event id
+ */
+typedef uint8_t evtid_t;
+
+/**
+ * Trace record type id
+ */
+typedef uint8_t trcid_t;
+
 /**********************************************
  * Keep most constants in separate namespaces
  **********************************************/
 
-// 256 number of unsigned long:s.
-const unsigned int EEPROM_SIZE = 1024;
+// EEPROM layout. Parameters use the first 1024 bytes (256 unsigned long:s),
+// the WiFi credential store and ADC calibration follow.
+const unsigned int EEPROM_SIZE = 2048;
+const unsigned int EEPROM_WIFI_POS = 1024;
+const unsigned int EEPROM_CAL_POS = 1536;
 
 namespace PINS {
 // Analogue pin is not specified here since there is only one choice: A0.
@@ -39,11 +52,29 @@ const uint8_t SERVO = 5; 	// PWM servo 3,3V signal
 const uint8_t MPX_EN = 0; 	// Mutiplexor enable
 const uint8_t MPX_S0 = 2; 	// Mutiplexor S0
 const uint8_t MPX_S1 = 4; 	// Mutiplexor S1
+// 74HC595 shift register chain for zones beyond the pump outputs. Clock is
+// shared with the unused servo output. The latch is shared with the
+// multiplexer enable, which only gives extra rising edges latching unchanged
+// data.
+const uint8_t SR_DATA = 16;	// Shift register serial data
+const uint8_t SR_CLOCK = SERVO;	// Shift register clock
+const uint8_t SR_LATCH = MPX_EN;	// Shift register latch (rising edge)
+}
+
+namespace ZONE {
+// Zones are watered one at a time. The first GPIO_COUNT zones use the pump
+// outputs, further zones the shift register outputs.
+const byte COUNT = 3;
+const byte GPIO_COUNT = 3;
+const uint8_t GPIO[GPIO_COUNT] = { PINS::PUMP1, PINS::PUMP2, PINS::PUMP3 };
 }
 
 namespace PRM {
 // Indentifiers for parameters which can be set or get
 const prmid_t NONE = 0x00;
+// Pump parameters from before zones, kept for deployed servers. They alias the
+// flow capacity, requested flow and pumped volume of zones 0 to 2, which are
+// uploaded with these ids.
 const prmid_t P1_FLOW_CAPACITY = 0x01;
 const prmid_t P2_FLOW_CAPACITY = 0x02;
 const prmid_t P3_FLOW_CAPACITY = 0x03;
@@ -53,6 +84,7 @@ const prmid_t P3_FLOW_REQUEST = 0x06;
 const prmid_t P1_PUMPED_VOL = 0x07;
 const prmid_t P2_PUMPED_VOL = 0x08;
 const prmid_t P3_PUMPED_VOL = 0x09;
+const byte LEGACY_ZONES = 3;		// Zones with the ids above
 const prmid_t TANK_SIZE = 0x0A;
 const prmid_t ONTIME = 0x0B;
 const prmid_t REFRESH_RATE = 0x0C;
@@ -61,18 +93,124 @@ const prmid_t ADC2 = 0x0E;
 const prmid_t ADC3 = 0x0F;
 const prmid_t ADC4 = 0x10;
 const prmid_t LAST_ERR = 0x11;
-const prmid_t _END = 0x12;
+const prmid_t WIFI_CONN_TIME = 0x12;
+const prmid_t WIFI_RSSI = 0x13;
+const prmid_t SYNC_DEBOUNCE = 0x14;
+const prmid_t PAUSE = 0x15;
+const prmid_t ADC_CAL = 0x16;
+const prmid_t ADC1_ENG = 0x17;
+const prmid_t ADC2_ENG = 0x18;
+const prmid_t ADC3_ENG = 0x19;
+const prmid_t ADC4_ENG = 0x1A;
+const prmid_t ADC_OVERSAMPLE = 0x1B;
+const prmid_t ADC_EMA = 0x1C;
+const prmid_t ADC_SETTLE = 0x1D;
+const prmid_t HEAP_FREE = 0x1E;
+const prmid_t HEAP_MAX_BLOCK = 0x1F;
+const prmid_t HEAP_FRAG = 0x20;
+const prmid_t TRACE_ENABLE = 0x21;
+const prmid_t TRACE_UPLOAD = 0x22;
+const prmid_t MQTT_ENABLE = 0x23;
+const prmid_t TLS_HANDSHAKE = 0x24;
+const prmid_t TLS_HEAP = 0x25;
+const prmid_t TIME = 0x26;
+const prmid_t TZ_OFFSET = 0x27;
+const prmid_t BUDGET_DAY = 0x28;
+const prmid_t FLOW_LEVEL_CH = 0x29;
+const prmid_t PUMP_CURRENT_CH = 0x2A;
+const prmid_t PUMP_CURRENT_MIN = 0x2B;
+const prmid_t PUMP_CURRENT_MAX = 0x2C;
+const prmid_t PUMP_FAULT = 0x2D;
+const prmid_t ADC1_FINE = 0x2E;
+const prmid_t ADC2_FINE = 0x2F;
+const prmid_t ADC3_FINE = 0x30;
+const prmid_t ADC4_FINE = 0x31;
+const prmid_t _END = 0x32;	// End of global parameters
+
+// Zone parameters are allocated in blocks of ZONE_STRIDE ids, the id of a
+// zone parameter is ZONE_BASE + zone * ZONE_STRIDE + offset. One offset is
+// spare, which leaves ids for 19 zones.
+const prmid_t ZONE_BASE = 0x40;
+const prmid_t ZONE_STRIDE = 0x0A;
+const prmid_t Z_FLOW_CAPACITY = 0x00;	// Offset of pump flow capacity
+const prmid_t Z_FLOW_REQUEST = 0x01;	// Offset of requested flow
+const prmid_t Z_PUMPED_VOL = 0x02;		// Offset of pumped volume
+const prmid_t Z_WINDOW_START = 0x03;	// Offset of watering window start
+const prmid_t Z_WINDOW_END = 0x04;		// Offset of watering window end
+const prmid_t Z_DAILY_BUDGET = 0x05;	// Offset of daily volume budget
+const prmid_t Z_PUMPED_TODAY = 0x06;	// Offset of volume pumped today
+const prmid_t Z_LAST_START = 0x07;		// Offset of time of last pump start
+const prmid_t Z_FLOW_ESTIMATE = 0x08;	// Offset of measured flow capacity
+
+// End of all parameter ids
+const unsigned int ID_END = ZONE_BASE + ZONE::COUNT * ZONE_STRIDE;
+static_assert(ID_END <= 0x100, "Too many zones for 8 bit parameter ids");
+
+/**
+ * Returns id of zone parameter at offset.
+ */
+inline prmid_t zoneId(byte zone, prmid_t offset) {
+	return ZONE_BASE + zone * ZONE_STRIDE + offset;
 }
+}
+
+namespace MEM {
+// Sizes of buffers allocated once in MachineState. No heap is used when
+// talking to the server.
+const unsigned short URL_SIZE = 96;
+const unsigned short PACKET_SIZE = (PRM::ID_END - 1) * 5 + 5;	// Upload packet
+const unsigned short LINE_SIZE = 64;	// Server response line
+const unsigned short TRACE_SIZE = 2048;	// Input trace ring buffer
+const unsigned short TOPIC_SIZE = 24;	// MQTT topic
+const unsigned short LAN_RX_SIZE = PACKET_SIZE + PRM::ID_END + 2;	// SET and GET of all
+}
+
+// TLS defaults, may be overridden by build flags like -DWIFI_USE_TLS=true
+#ifndef WIFI_USE_TLS
+#define WIFI_USE_TLS false
+#endif
+#ifndef WIFI_TLS_FINGERPRINT
+#define WIFI_TLS_FINGERPRINT nullptr
+#endif
 
 namespace WIFI {
-// Constants for wifi connection
+// Constants for wifi connection. Ssid, password and host are defaults used
+// until networks are provisioned to the EEPROM credential store.
 char const * const ssid = "Gris";
 char const * const password = "isterband";
 char const * const host = "skarmflyg.org";
-char const * const download_url = "http://skarmflyg.org/hw/download.php";
-char const * const upload_url = "http://skarmflyg.org/hw/upload.php";
+char const * const download_path = "/hw/download.php";
+char const * const upload_path = "/hw/upload.php";
+char const * const trace_path = "/hw/trace.php";
 const unsigned int WIFI_RX_TIMEOUT = 5000;	// 5 seconds
+const unsigned int CONNECT_TIMEOUT = 10000;	// Per network, 10 seconds
+const unsigned int FAST_CONNECT_TIMEOUT = 3000; // Cached channel/BSSID, 3 s
+const int ROAM_RSSI = -75;	// Look for a better network below this [dBm]
+const int ROAM_MARGIN = 8;	// Required improvement to switch network [dB]
+const unsigned long ROAM_SCAN_INTERVAL = 300000; // Least time between roam scans, 5 min
+const unsigned long RECONNECT_INTERVAL = 10000; // Wait after a failed connection, 10 s
 const uint8_t http_port = 80;
+const bool use_tls = WIFI_USE_TLS;	// Use https to the server, set a server key below
+const uint16_t https_port = 443;
+const uint16_t tls_fragment = 512;	// Reduced TLS buffers if server has MFLN
+// The server is verified by the SHA-1 fingerprint of its certificate like
+// "AB CD ..", or else by a PEM CA certificate. With use_tls and neither set
+// requests fail, the server is never used unverified.
+char const * const tls_fingerprint = WIFI_TLS_FINGERPRINT;
+char const * const tls_trust_anchor = nullptr;
+const uint16_t lan_port = 8266;				// Local control port
+const uint16_t mqtt_port = 1883;			// MQTT broker port on host, plaintext
+// Broker login, nullptr for none. Sent in clear text, see README.
+char const * const mqtt_user = nullptr;
+char const * const mqtt_pass = nullptr;
+char const * const mqtt_cmd_topic = "hw/%x/cmd";	// Chip id, commands in
+char const * const mqtt_prm_topic = "hw/%x/prm";	// Chip id, parameters out
+const unsigned int MQTT_RETRY = 10000;		// First reconnect interval, 10 seconds
+const unsigned long MQTT_RETRY_MAX = 320000;	// Doubled up to 5 min 20 s
+const unsigned int MQTT_CONNECT_TIMEOUT = 500;	// TCP connect to broker, 500 ms
+const uint16_t MQTT_SOCKET_TIMEOUT = 1;		// Wait for broker replies, 1 s
+const unsigned int MQTT_PUBLISH_INTERVAL = 1000;	// Check for changes, 1 s
+const unsigned int LAN_IDLE_TIMEOUT = 2000;	// Apply or drop after 2 s silence
 }
 
 namespace CMD {
@@ -83,6 +221,54 @@ const cmdid_t SET = 0x02;
 const cmdid_t _END = 0x03;
 }
 
+namespace ANALOG {
+// Filtered ADC values are counts in fixed point with FRACTION_BITS fraction
+// bits, which hold the extra bits from oversampling and averaging.
+const byte FRACTION_BITS = 6;
+const unsigned long FINE_MAX = 1023UL << FRACTION_BITS;
+}
+
+namespace FLOW {
+// Pump flow monitoring, see MachineState::checkFlow()
+const unsigned long SPINUP_TIME = 2000;		// Run time before first check [ms]
+const unsigned long CHECK_INTERVAL = 1000;	// Time between checks [ms]
+const unsigned long LEVEL_CHECK_TIME = 10000; // Run time before level checks [ms]
+const byte MIN_FLOW_PCT = 25;	// Least measured flow, percent of estimated
+const unsigned long MIN_RUN = 20;	// Shortest run to refine the estimate [s]
+const float FORGET = 0.9f;		// Estimator forgetting factor
+const float P_START = 10.0f;	// Estimator start variance
+}
+
+namespace EVT {
+// Events decoded from the sync input
+const evtid_t NONE = 0x00;
+const evtid_t SHORT_PRESS = 0x01;	// Force sync with server
+const evtid_t LONG_PRESS = 0x02;	// Prime next pump
+const evtid_t DOUBLE_PRESS = 0x03;	// Pause or resume watering
+const unsigned int LONG_PRESS_TIME = 2000;	// Held at least 2 seconds
+const unsigned int DOUBLE_PRESS_GAP = 400;	// Second press within 400 ms
+}
+
+namespace TRC {
+// Input trace record types. Each record is the type byte, the time since the
+// previous record in ms as a base 128 varint (low 7 bits first, high bit set
+// if more bytes follow) and a type specific payload.
+const trcid_t NONE = 0x00;
+const trcid_t BOOT = 0x01;		// No payload
+const trcid_t REFRESH = 0x02;	// No payload, server sync started
+const trcid_t SYNC_EDGE = 0x03;	// No payload, edge on sync input
+const trcid_t ADC = 0x04;		// Channel, fine value MSB, LSB, see ANALOG
+const trcid_t PUMP = 0x05;		// Pump index << 1 | 1 if switched on
+const trcid_t RX = 0x06;		// Length n | RX_LAST, n received command bytes
+const trcid_t CLOCK = 0x07;		// Unix time in seconds, MSB first, clock was set
+const trcid_t _END = 0x08;
+
+// Command streams are recorded as received in RX records of at most RX_MAX
+// bytes, the last record of a stream has RX_LAST set in its length byte.
+const byte RX_MAX = 16;
+const byte RX_LAST = 0x80;
+}
+
 namespace ERR {
 const byte NOERR = 0x00;
 const byte CONN_ERR = 0x01;
@@ -96,7 +282,11 @@ const byte PARAMID_GET_ERR = 0x09;
 const byte NULLPTR_ERR = 0x0A;
 const byte BUFFER_OVERRUN = 0x0B;
 const byte EMPTY_INSTREAM = 0x0C;
-const byte _END = 0x0C;
+const byte PUMP_DRY = 0x0D;
+const byte PUMP_BLOCKED = 0x0E;
+const byte PUMP_NO_FLOW = 0x0F;
+const byte TLS_UNTRUSTED = 0x10;	// TLS enabled without a way to verify server
+const byte _END = 0x10;
 
 const actid_t NONE = 0x00;
 const actid_t UPLOAD = 0x01;
@@ -3,16 +3,61 @@
 
 #include <EEPROM.h>
 #include "consts_and_types.h"
+#include "Benchmark.h"
 #include "MachineState.h"
 
 MachineState M;
-volatile bool manual_refresh;
+bool manual_refresh;
 unsigned long time_last_refresh;
 unsigned long now;
+uint64_t now64;
 
-void onSyncPinInterrupt() {
-	// Set flag to refresh parameters from server
-	manual_refresh = true;
+void ICACHE_RAM_ATTR onSyncPinInterrupt() {
+	// Only queue the edge, it is decoded in the program loop
+	M.sync.onEdge();
+}
+
+/**
+ * Handle a command line from the serial port if one is available. Besides the
+ * WifiConfig provisioning commands "bench" runs the benchmarks.
+ */
+void handleSerialCommand() {
+	char line[120];
+	size_t len;
+
+	if (!Serial.available()) {
+		return;
+	}
+
+	len = Serial.readBytesUntil('\n', line, sizeof(line) - 1);
+	line[len] = '\0';
+
+	if (strncmp(line, "bench", 5) == 0) {
+		Benchmark(&M).runAll();
+	} else if (!M.wifi.provision(line)) {
+		Serial.print("\n**Unknown command");
+	}
+}
+
+/**
+ * Act on events from the sync input. Sync requests are coalesced into the
+ * manual_refresh flag so at most one sync runs at a time.
+ */
+void handleSyncEvent(evtid_t evt) {
+	switch (evt) {
+	case EVT::SHORT_PRESS:
+		manual_refresh = true;
+		break;
+	case EVT::LONG_PRESS:
+		M.primeNextPump(now64);
+		break;
+	case EVT::DOUBLE_PRESS:
+		M.pause.set(!M.pause.get());
+		Serial.print(M.pause.get() ? "\nPaused" : "\nResumed");
+		break;
+	default:
+		break;
+	}
 }
 
 void setup() {
@@ -24,13 +69,8 @@ void setup() {
 	// Init values
 	time_last_refresh = -1UL;
 	manual_refresh = true;
-	M.refresh.set(10000);
-
-	// All parameters are initialized to its lower limit. Some should be
-	// read back parameter from EEPROM though.
-	M.pumped1.eepromLoad();
-	M.pumped2.eepromLoad();
-	M.pumped3.eepromLoad();
+	M.begin();
+	M.trace.record(TRC::BOOT);
 
 	// Setup gpio pins
 	pinMode(A0, INPUT);
@@ -43,26 +83,45 @@ void setup() {
 	digitalWrite(PINS::MPX_EN, HIGH);
 	// Servo signal to 0 volt
 	digitalWrite(PINS::SERVO, LOW);
+	// All zone outputs off
+	M.outputs.begin();
 
-	// Connecting to a WiFi network
+	// Connecting to a known WiFi network
 	Serial.print("\nConnecting ");
-	WiFi.begin(WIFI::ssid, WIFI::password);
-	while (WiFi.status() != WL_CONNECTED) {
-		delay(5000);
+	M.wifi.load();
+	while (!M.connectWifi()) {
+		handleSerialCommand();
+		delay(500);
 		Serial.print(".");
 	}
 	delay(100);
 	Serial.print("\nWiFi connected. IP: ");
 	Serial.println(WiFi.localIP());
 
-	// Use pin PINS::SYNC as input to synchronize with server directly
+	// Take the wall clock from the server host
+	M.beginClock();
+
+	// Set up encryption of the server connection
+	M.beginTls();
+
+	// Accept parameter get/set requests from the local network
+	M.beginLocalServer();
+
+	// Receive parameter changes pushed over MQTT when enabled
+	M.beginMqtt();
+
+	// Use pin PINS::SYNC as push button. Short press synchronizes with server
+	// directly, long press primes a pump and double press pauses watering.
 	attachInterrupt(digitalPinToInterrupt(PINS::SYNC), onSyncPinInterrupt,
-	FALLING);
+	CHANGE);
 }
 
 void loop() {
 	bool auto_refresh;
-	now = millis();
+	// 64 bit time for the pumps, 32 bit is enough for short intervals
+	now64 = M.clock.update();
+	now = (unsigned long) now64;
+	handleSyncEvent(M.sync.poll(now));
 	auto_refresh = now - time_last_refresh > M.refresh.get();
 
 	if (auto_refresh || manual_refresh) {
@@ -72,12 +131,27 @@ void loop() {
 
 		manual_refresh = false;
 		time_last_refresh = now;
+		M.trace.record(TRC::REFRESH);
 
-		M.downloadFromServer();
-		yield(); // Let the ESP8266 do its thing too
-		M.uploadToServer();
+		// Reconnect or roam to a stronger access point if needed
+		if (M.connectWifi()) {
+			M.clock.pollSntp();
+			M.downloadFromServer();
+			yield(); // Let the ESP8266 do its thing too
+			M.uploadToServer();
+			yield(); // Let the ESP8266 do its thing too
+			M.uploadTrace();
+		}
 	}
 
+	handleSerialCommand();
+
+	yield(); // Let the ESP8266 do its thing too
+	M.serveLocalClient(now);
+
+	yield(); // Let the ESP8266 do its thing too
+	M.serveMqtt(now);
+
 	yield(); // Let the ESP8266 do its thing too
-	M.run(now);
+	M.run(now64);
 }
@@ -0,0 +1,251 @@
+#include "TraceReplay.h"
+
+#include "BufferStream.h"
+
+// Fine ADC value per multiplexer channel, returned by analogRead()
+static unsigned long channel_fine[AdcFilter::CHANNELS];
+
+static int replayAnalog(unsigned long) {
+	byte channel = (HOST::pins[PINS::MPX_S0] ? 1 : 0)
+			| (HOST::pins[PINS::MPX_S1] ? 2 : 0);
+	return channel_fine[channel] >> ANALOG::FRACTION_BITS;
+}
+
+// Unix time of a CLOCK record payload
+static unsigned long epoch(const std::vector<byte>& p) {
+	return ((unsigned long) p[0] << 24) | ((unsigned long) p[1] << 16)
+			| ((unsigned long) p[2] << 8) | p[3];
+}
+
+/**
+ * Decode a trace into records. Returns false if the trace ends inside a
+ * record or holds an unknown record type, the records before are kept.
+ */
+bool TraceReplay::decode(const byte * const trace, const size_t size,
+		std::vector<Record> * const records) {
+	unsigned long time = 0;
+	size_t pos = 0;
+	byte shift;
+	size_t len;
+
+	while (pos < size) {
+		Record rec;
+		rec.type = trace[pos++];
+		if (rec.type == TRC::NONE || rec.type >= TRC::_END) {
+			return false;
+		}
+
+		// Varint time delta
+		unsigned long dt = 0;
+		shift = 0;
+		do {
+			if (pos >= size || shift > 28) {
+				return false;
+			}
+			dt |= (unsigned long) (trace[pos] & 0x7F) << shift;
+			shift += 7;
+		} while (trace[pos++] & 0x80);
+		time += dt;
+		rec.time = time;
+
+		switch (rec.type) {
+		case TRC::ADC:
+			len = 3;
+			break;
+		case TRC::PUMP:
+			len = 1;
+			break;
+		case TRC::CLOCK:
+			len = 4;
+			break;
+		case TRC::RX:
+			len = (pos < size) ? 1 + (trace[pos] & ~TRC::RX_LAST) : 1;
+			break;
+		default:
+			len = 0;
+			break;
+		}
+		if (pos + len > size) {
+			return false;
+		}
+		rec.payload.assign(trace + pos, trace + pos + len);
+		pos += len;
+		records->push_back(rec);
+	}
+	return true;
+}
+
+/**
+ * Print a record as one line of text.
+ */
+void TraceReplay::print(const Record& rec, FILE * const out) {
+	static const char * const names[] = { "NONE", "BOOT", "REFRESH",
+			"SYNC_EDGE", "ADC", "PUMP", "RX", "CLOCK" };
+	const std::vector<byte>& p = rec.payload;
+
+	fprintf(out, "%10lu %-9s", rec.time, names[rec.type]);
+	switch (rec.type) {
+	case TRC::ADC:
+		fprintf(out, " channel=%u fine=%u", p[0] + 1, (p[1] << 8) | p[2]);
+		break;
+	case TRC::PUMP:
+		fprintf(out, " zone=%u %s", p[0] >> 1, (p[0] & 1) ? "on" : "off");
+		break;
+	case TRC::RX:
+		fprintf(out, " %s", (p[0] & TRC::RX_LAST) ? "last" : "more");
+		for (size_t k = 1; k < p.size(); k++) {
+			fprintf(out, " %02X", p[k]);
+		}
+		break;
+	case TRC::CLOCK:
+		fprintf(out, " epoch=%lu", epoch(p));
+		break;
+	default:
+		break;
+	}
+	fprintf(out, "\n");
+}
+
+/**
+ * Constructor. The machine is set up as by the sketch.
+ */
+TraceReplay::TraceReplay(MachineState * const machine) :
+		m(machine), outputs { } {
+	HOST::now_ms = 0;
+	HOST::analog = replayAnalog;
+	HOST::pins[PINS::SYNC] = HIGH; // Released
+	m->begin();
+}
+
+/**
+ * Replay records, stepping the program loop every step_ms in between.
+ */
+void TraceReplay::run(const std::vector<Record>& records,
+		unsigned long step_ms) {
+	unsigned long now = HOST::now_ms;
+
+	for (const Record& rec : records) {
+		while (rec.time > now + step_ms) {
+			now += step_ms;
+			step(now);
+		}
+		now = std::max(now, rec.time);
+		HOST::now_ms = now;
+		apply(rec);
+		step(now);
+	}
+}
+
+/**
+ * Compare the decisions of the replay with the recorded ones. Returns the
+ * number of differences, which are printed to out.
+ *
+ * @param tolerance_ms Largest accepted time difference of a decision.
+ */
+unsigned int TraceReplay::diff(unsigned long tolerance_ms,
+		FILE * const out) const {
+	unsigned int differences = 0;
+	size_t n = std::max(expected.size(), actual.size());
+
+	for (size_t k = 0; k < n; k++) {
+		if (k >= expected.size()) {
+			fprintf(out, "+ %10lu zone=%u %s\n", actual[k].time,
+					actual[k].zone, actual[k].on ? "on" : "off");
+		} else if (k >= actual.size()) {
+			fprintf(out, "- %10lu zone=%u %s\n", expected[k].time,
+					expected[k].zone, expected[k].on ? "on" : "off");
+		} else if (expected[k].zone != actual[k].zone
+				|| expected[k].on != actual[k].on
+				|| labs((long) (expected[k].time - actual[k].time))
+						> (long) tolerance_ms) {
+			fprintf(out, "- %10lu zone=%u %s\n+ %10lu zone=%u %s\n",
+					expected[k].time, expected[k].zone,
+					expected[k].on ? "on" : "off", actual[k].time,
+					actual[k].zone, actual[k].on ? "on" : "off");
+		} else {
+			continue;
+		}
+		++differences;
+	}
+	return differences;
+}
+
+/**
+ * Parse a received command stream.
+ */
+void TraceReplay::command(const byte * const cmds, const size_t len) {
+	BufferStream stream(cmds, len);
+	m->parseCommandStream(&stream);
+}
+
+/**
+ * One pass of the program loop without network, see loop() in the sketch.
+ */
+void TraceReplay::step(unsigned long now) {
+	HOST::now_ms = now;
+	uint64_t now64 = m->clock.update();
+
+	switch (m->sync.poll(now)) {
+	case EVT::LONG_PRESS:
+		m->primeNextPump(now64);
+		break;
+	case EVT::DOUBLE_PRESS:
+		m->pause.set(!m->pause.get());
+		break;
+	default:
+		break;
+	}
+
+	m->run(now64);
+
+	for (byte k = 0; k < ZONE::COUNT; k++) {
+		bool on = m->outputs.get(k);
+		if (on != outputs[k]) {
+			outputs[k] = on;
+			actual.push_back( { now, k, on });
+		}
+	}
+}
+
+/***************
+ * Private
+ ***************/
+
+/**
+ * Feed one recorded input to the machine.
+ */
+void TraceReplay::apply(const Record& rec) {
+	const std::vector<byte>& p = rec.payload;
+
+	switch (rec.type) {
+	case TRC::SYNC_EDGE:
+		HOST::pins[PINS::SYNC] = !HOST::pins[PINS::SYNC];
+		m->sync.onEdge();
+		break;
+
+	case TRC::ADC:
+		if (p[0] < AdcFilter::CHANNELS) {
+			channel_fine[p[0]] = (p[1] << 8) | p[2];
+		}
+		break;
+
+	case TRC::RX:
+		rx.insert(rx.end(), p.begin() + 1, p.end());
+		if (p[0] & TRC::RX_LAST) {
+			command(rx.data(), rx.size());
+			rx.clear();
+		}
+		break;
+
+	case TRC::CLOCK:
+		m->clock.set(epoch(p));
+		break;
+
+	case TRC::PUMP:
+		expected.push_back( { rec.time, (byte) (p[0] >> 1), (p[0] & 1) != 0 });
+		break;
+
+	default:
+		break;
+	}
+}
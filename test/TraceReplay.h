@@ -0,0 +1,60 @@
+#ifndef TraceReplay_H_
+#define TraceReplay_H_
+
+#include <vector>
+#include "MachineState.h"
+
+/**
+ * Host replay of an input trace, see TRC.
+ *
+ * The recorded inputs are fed to a MachineState at their recorded times:
+ * command streams in RX records go through the real parser, ADC values are
+ * returned by analogRead() for the selected channel and sync edges drive the
+ * sync input. Between records the program loop is stepped like loop() in the
+ * sketch, without network. Pump decisions are compared with the PUMP records.
+ *
+ * The machine starts from MachineState::begin() defaults with erased EEPROM.
+ * State from before the first record, e.g. parameters set before the ring
+ * buffer wrapped, is not known to the replay.
+ */
+class TraceReplay {
+public:
+	struct Record {
+		unsigned long time;		// Time from start of trace [ms]
+		trcid_t type;
+		std::vector<byte> payload;
+	};
+
+	struct Decision {
+		unsigned long time;		// [ms]
+		byte zone;
+		bool on;
+	};
+
+	std::vector<Decision> expected;	// From PUMP records
+	std::vector<Decision> actual;	// Made by the replay
+
+	static bool decode(const byte * const trace, const size_t size,
+			std::vector<Record> * const records);
+
+	static void print(const Record& rec, FILE * const out);
+
+	explicit TraceReplay(MachineState * const machine);
+
+	void run(const std::vector<Record>& records, unsigned long step_ms);
+
+	unsigned int diff(unsigned long tolerance_ms, FILE * const out) const;
+
+	void command(const byte * const cmds, const size_t len);
+
+	void step(unsigned long now);
+
+private:
+	MachineState * const m;
+	std::vector<byte> rx;	// Command stream being received
+	bool outputs[ZONE::COUNT];
+
+	void apply(const Record& rec);
+};
+
+#endif
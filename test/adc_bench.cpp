@@ -0,0 +1,122 @@
+/**
+ * Host benchmark of AdcFilter. Feeds noisy and recorded ADC traces through
+ * the filter for every ADC_OVERSAMPLE and ADC_EMA setting and prints a JSON
+ * array to stdout with one object per trace and setting:
+ * - raw_std;           Standard deviation of the raw samples [counts]
+ * - std;               Standard deviation of the filtered reads [counts]
+ * - std_reduction;     raw_std / std, null if the reads did not vary
+ * - reads_per_sample;  analogRead() calls per filtered read
+ * - ns_per_sample;     Mean host time per filtered read [ns]
+ *
+ * Run with "make -C test bench".
+ */
+
+#include <chrono>
+#include <math.h>
+#include <random>
+#include "AdcFilter.h"
+
+static const unsigned int READS = 2000;
+
+// Samples of the four channels at 2000 mV from ADC-calibration.ods
+static const int RECORDED[] = { 395, 393, 392, 398, 397, 400, 402, 401, 400,
+		399, 400, 404, 399, 397, 397, 396, 399, 396, 401, 402, 400, 399, 399,
+		400 };
+
+static std::mt19937 rng;
+static unsigned long analog_reads = 0;
+static double raw_sum = 0;
+static double raw_sum2 = 0;
+
+static int take(int x) {
+	x = std::max(0, std::min(1023, x));
+	++analog_reads;
+	raw_sum += x;
+	raw_sum2 += (double) x * x;
+	return x;
+}
+
+// 512 counts with 2 counts of gaussian noise
+static int gaussian(unsigned long) {
+	static std::normal_distribution<double> noise(0.0, 2.0);
+	return take(lround(512 + noise(rng)));
+}
+
+// As gaussian with a full scale spike in every 100th sample on average
+static int spiky(unsigned long) {
+	static std::normal_distribution<double> noise(0.0, 2.0);
+	static std::uniform_int_distribution<int> spike(0, 99);
+	return take(spike(rng) == 0 ? 1023 : lround(512 + noise(rng)));
+}
+
+// Recorded samples drawn at random
+static int recorded(unsigned long) {
+	static std::uniform_int_distribution<size_t> pick(0,
+			sizeof(RECORDED) / sizeof(RECORDED[0]) - 1);
+	return take(RECORDED[pick(rng)]);
+}
+
+static void bench(const char * const name, int (*trace)(unsigned long),
+		byte bits, byte shift, bool * const first) {
+	Parameter oversample { PRM::ADC_OVERSAMPLE, 0, 3UL };
+	Parameter ema { PRM::ADC_EMA, 0, 8UL };
+	AdcFilter filter { &oversample, &ema };
+	double sum = 0;
+	double sum2 = 0;
+	unsigned int n = 0;
+
+	oversample.set(bits);
+	ema.set(shift);
+	HOST::analog = trace;
+	rng.seed(1);
+	analog_reads = 0;
+	raw_sum = raw_sum2 = 0;
+
+	// Skip the start of the moving average, 8 time constants
+	unsigned int warmup = 8 << shift;
+
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int k = 0; k < warmup + READS; k++) {
+		double x = (double) filter.read(0) / (1 << ANALOG::FRACTION_BITS);
+		if (k >= warmup) {
+			sum += x;
+			sum2 += x * x;
+			++n;
+		}
+	}
+	auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start).count();
+
+	double raw_mean = raw_sum / analog_reads;
+	double raw_std = sqrt(
+			std::max(0.0, raw_sum2 / analog_reads - raw_mean * raw_mean));
+	double mean = sum / n;
+	double std = sqrt(std::max(0.0, sum2 / n - mean * mean));
+
+	printf("%s{\"trace\":\"%s\",\"oversample\":%u,\"ema\":%u,"
+			"\"raw_std\":%.3f,\"std\":%.4f,", *first ? "[\n" : ",\n", name,
+			bits, shift, raw_std, std);
+	if (std > 0) {
+		printf("\"std_reduction\":%.1f,", raw_std / std);
+	} else {
+		printf("\"std_reduction\":null,");
+	}
+	printf("\"reads_per_sample\":%.1f,\"ns_per_sample\":%.1f}",
+			(double) analog_reads / (warmup + READS),
+			(double) ns / (warmup + READS));
+	*first = false;
+}
+
+int main() {
+	bool first = true;
+
+	for (byte bits = 0; bits <= 3; bits++) {
+		for (byte shift = 0; shift <= 8; shift++) {
+			bench("gaussian", gaussian, bits, shift, &first);
+			bench("spiky", spiky, bits, shift, &first);
+			bench("recorded", recorded, bits, shift, &first);
+		}
+	}
+	printf("\n]\n");
+	return 0;
+}
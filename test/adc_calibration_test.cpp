@@ -0,0 +1,128 @@
+/**
+ * Replays the calibration points of ADC-calibration.ods through
+ * AdcCalibration. The mean count of each input voltage must convert to the
+ * exact voltage and every single sample to within the measured spread.
+ */
+
+#include "AdcCalibration.h"
+#include "EEPROM.h"
+#include "consts_and_types.h"
+#include "check.h"
+
+static const unsigned int VOLTS_MV[] = { 0, 1000, 2000, 3000, 4000, 4250 };
+
+// Mean count per channel and voltage, rounded ("medel")
+static const unsigned int MEAN[4][6] = {
+		{ 8, 201, 396, 596, 796, 844 },
+		{ 8, 202, 401, 593, 795, 844 },
+		{ 9, 199, 397, 596, 795, 843 },
+		{ 8, 201, 400, 592, 795, 843 } };
+
+// Samples v1..v6 per channel and voltage
+static const unsigned int SAMPLES[4][6][6] = {
+		{ { 9, 10, 8, 8, 7, 7 }, { 205, 198, 200, 198, 198, 205 }, //
+		{ 395, 393, 392, 398, 397, 400 }, { 595, 596, 593, 601, 595, 597 }, //
+		{ 797, 794, 795, 799, 793, 795 }, { 846, 843, 844, 842, 844, 843 } },
+		{ { 8, 7, 7, 8, 8, 8 }, { 201, 205, 202, 203, 201, 200 }, //
+		{ 402, 401, 400, 399, 400, 404 }, { 593, 593, 592, 590, 591, 596 }, //
+		{ 792, 791, 798, 794, 794, 798 }, { 844, 844, 846, 843, 843, 842 } },
+		{ { 7, 8, 11, 7, 9, 10 }, { 198, 199, 202, 195, 197, 201 }, //
+		{ 399, 397, 397, 396, 399, 396 }, { 594, 595, 595, 597, 594, 600 }, //
+		{ 795, 794, 795, 794, 796, 795 }, { 845, 841, 842, 842, 843, 843 } },
+		{ { 8, 8, 8, 7, 8, 8 }, { 202, 201, 200, 203, 204, 198 }, //
+		{ 401, 402, 400, 399, 399, 400 }, { 594, 590, 593, 591, 592, 591 }, //
+		{ 792, 793, 795, 793, 796, 799 }, { 842, 842, 845, 842, 842, 847 } } };
+
+// Largest sample spread is 4 counts from the mean, about 21 mV
+static const int SAMPLE_TOL_MV = 25;
+
+/**
+ * Returns an ADC_CAL parameter value setting a point.
+ */
+static unsigned long packPoint(byte channel, byte point, unsigned int raw,
+		unsigned int val) {
+	return ((unsigned long) channel << 30) | ((unsigned long) point << 27)
+			| ((unsigned long) raw << 16) | val;
+}
+
+static void testSpreadsheetPoints() {
+	AdcCalibration cal;
+	cal.load();
+
+	for (byte c = 0; c < 4; c++) {
+		for (byte v = 0; v < 6; v++) {
+			CHECK_EQ(cal.convert(c, MEAN[c][v]), VOLTS_MV[v]);
+			for (byte s = 0; s < 6; s++) {
+				CHECK_NEAR(cal.convert(c, SAMPLES[c][v][s]), VOLTS_MV[v],
+						SAMPLE_TOL_MV);
+			}
+		}
+	}
+}
+
+static void testClampAndMonotonic() {
+	AdcCalibration cal;
+	cal.load();
+
+	for (byte c = 0; c < 4; c++) {
+		CHECK_EQ(cal.convert(c, 0), 0);
+		CHECK_EQ(cal.convert(c, 1023), 4250);
+		for (unsigned int raw = 1; raw < 1024; raw++) {
+			CHECK(cal.convert(c, raw) >= cal.convert(c, raw - 1));
+		}
+	}
+}
+
+static void testSetPoint() {
+	AdcCalibration cal;
+	cal.load();
+
+	// Move a point and read it back exactly
+	CHECK(cal.setPoint(packPoint(1, 2, 410, 2100)));
+	CHECK_EQ(cal.convert(1, 410), 2100);
+	CHECK_EQ(cal.convert(1, 202), 1000);
+	CHECK_EQ(cal.convert(1, 593), 3000);
+
+	// Saved to EEPROM
+	AdcCalibration reloaded;
+	reloaded.load();
+	CHECK_EQ(reloaded.convert(1, 410), 2100);
+
+	// Falling curve, e.g. a level sensor
+	for (byte k = 0; k < AdcCalibration::POINTS; k++) {
+		CHECK(cal.setPoint(packPoint(2, k, 0, 0) | (1UL << 26)));
+	}
+	CHECK(cal.setPoint(packPoint(2, 0, 100, 5000)));
+	CHECK_EQ(cal.convert(2, 500), 500); // One point passes raw through
+	CHECK(cal.setPoint(packPoint(2, 1, 900, 0)));
+	CHECK_EQ(cal.convert(2, 100), 5000);
+	CHECK_EQ(cal.convert(2, 500), 2500);
+	CHECK_EQ(cal.convert(2, 900), 0);
+
+	// Steep segment does not overflow
+	CHECK(cal.setPoint(packPoint(3, 0, 10, 0)));
+	CHECK(cal.setPoint(packPoint(3, 1, 11, 0xFFFF)));
+	CHECK_EQ(cal.convert(3, 11), 0xFFFF);
+
+	CHECK(!cal.setPoint(packPoint(0, 6, 0, 0)));
+}
+
+static void testFine() {
+	AdcCalibration cal;
+	cal.load();
+
+	// Channel 0 is 1000 mV over 195 counts from 201 to 396
+	CHECK_EQ(cal.convertFine(0, 201UL << ANALOG::FRACTION_BITS), 1000);
+	CHECK_EQ(cal.convertFine(0, (201UL << ANALOG::FRACTION_BITS) + 32), 1003);
+	CHECK_EQ(cal.convertFine(0, (201UL << ANALOG::FRACTION_BITS) + 16), 1001);
+	CHECK_EQ(cal.convertFine(0, 396UL << ANALOG::FRACTION_BITS), 2000);
+	CHECK_EQ(cal.convertFine(0, ANALOG::FINE_MAX), 4250);
+}
+
+int main() {
+	testSpreadsheetPoints();
+	testFine();
+	testClampAndMonotonic();
+	testSetPoint();
+	return check_failures ? 1 : 0;
+}
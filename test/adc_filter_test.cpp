@@ -0,0 +1,82 @@
+/**
+ * Checks that AdcFilter rejects spikes, keeps the extra bits from
+ * oversampling and restarts its moving average on reset().
+ */
+
+#include "AdcFilter.h"
+#include "check.h"
+
+static unsigned long samples = 0;
+
+// Alternates 500 and 501, a true value of 500.5 counts
+static int dither(unsigned long) {
+	return 500 + (samples++ & 1);
+}
+
+// Steady 300 with a spike every 50th sample
+static int spiky(unsigned long) {
+	return (++samples % 50 == 0) ? 1023 : 300;
+}
+
+static void testExtraBits() {
+	Parameter oversample { PRM::ADC_OVERSAMPLE, 0, 3UL };
+	Parameter ema { PRM::ADC_EMA, 0, 8UL };
+	AdcFilter filter { &oversample, &ema };
+
+	HOST::analog = dither;
+	oversample.set(2);
+	ema.set(0);
+	CHECK_EQ(filter.read(0), 500 * 64 + 32);
+
+	// Without oversampling the fraction is lost
+	oversample.set(0);
+	CHECK_EQ(filter.read(1) >> ANALOG::FRACTION_BITS, 500);
+}
+
+static void testSpikes() {
+	Parameter oversample { PRM::ADC_OVERSAMPLE, 0, 3UL };
+	Parameter ema { PRM::ADC_EMA, 0, 8UL };
+	AdcFilter filter { &oversample, &ema };
+
+	HOST::analog = spiky;
+	oversample.set(1);
+	ema.set(1);
+	for (byte k = 0; k < 20; k++) {
+		CHECK_EQ(filter.read(2), 300UL << ANALOG::FRACTION_BITS);
+	}
+}
+
+// Steady input set by the test
+static int level = 0;
+
+static int steady(unsigned long) {
+	return level;
+}
+
+static void testReset() {
+	Parameter oversample { PRM::ADC_OVERSAMPLE, 0, 3UL };
+	Parameter ema { PRM::ADC_EMA, 0, 8UL };
+	AdcFilter filter { &oversample, &ema };
+
+	HOST::analog = steady;
+	oversample.set(0);
+	ema.set(1);
+	level = 600;
+	filter.read(3);
+
+	// Averaged with the old value the drop reads half as large
+	level = 400;
+	CHECK_EQ(filter.read(3), 500UL << ANALOG::FRACTION_BITS);
+
+	// A restarted average reads the input as it is
+	level = 200;
+	filter.reset(3);
+	CHECK_EQ(filter.read(3), 200UL << ANALOG::FRACTION_BITS);
+}
+
+int main() {
+	testExtraBits();
+	testSpikes();
+	testReset();
+	return check_failures ? 1 : 0;
+}
@@ -0,0 +1,42 @@
+#ifndef CHECK_H_
+#define CHECK_H_
+
+#include <stdio.h>
+
+/**
+ * Minimal test helpers. Failed checks are printed and counted, a test
+ * program returns the count.
+ */
+static int check_failures = 0;
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+			++check_failures; \
+		} \
+	} while (0)
+
+#define CHECK_EQ(a, b) \
+	do { \
+		long long a_ = (long long) (a); \
+		long long b_ = (long long) (b); \
+		if (a_ != b_) { \
+			printf("%s:%d: %s == %s failed, %lld != %lld\n", __FILE__, \
+					__LINE__, #a, #b, a_, b_); \
+			++check_failures; \
+		} \
+	} while (0)
+
+#define CHECK_NEAR(a, b, tol) \
+	do { \
+		long long a_ = (long long) (a); \
+		long long b_ = (long long) (b); \
+		if (a_ - b_ > (tol) || b_ - a_ > (tol)) { \
+			printf("%s:%d: %s near %s failed, %lld != %lld +-%d\n", __FILE__, \
+					__LINE__, #a, #b, a_, b_, (int) (tol)); \
+			++check_failures; \
+		} \
+	} while (0)
+
+#endif
@@ -0,0 +1,163 @@
+/**
+ * Host benchmarks of the core routines, the routines of Benchmark plus a
+ * machine run. Prints a JSON array to stdout with one object per routine:
+ * - ns_per_op;     Mean host time per call [ns]
+ * - allocs_per_op; Heap allocations per call, counted by a replaced
+ *                  operator new
+ * - flash_per_op;  Bytes written to flash per call, from the commits to the
+ *                  EEPROM stub
+ *
+ * Run with "make -C test bench".
+ */
+
+#include <EEPROM.h>
+#include <chrono>
+#include <new>
+#include "BufferStream.h"
+#include "MachineState.h"
+
+static unsigned long allocations = 0;
+
+void * operator new(size_t size) {
+	++allocations;
+	void * p = malloc(size ? size : 1);
+	if (p == nullptr) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void * operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void * p) noexcept {
+	free(p);
+}
+
+void operator delete[](void * p) noexcept {
+	free(p);
+}
+
+class HostBench {
+public:
+	HostBench(MachineState * const machine, MachineState * const idle) :
+			m(machine), idle_machine(idle), first(true) {
+	}
+
+	void runAll();
+
+private:
+	MachineState * const m;
+	MachineState * const idle_machine;	// Never pumps nor saves
+	bool first;	// No result printed yet
+
+	template<typename F>
+	void measure(const char * const name, const unsigned int iterations, F op);
+};
+
+/**
+ * Run op iterations times and print the result.
+ */
+template<typename F>
+void HostBench::measure(const char * const name,
+		const unsigned int iterations, F op) {
+	unsigned long allocs = allocations;
+	unsigned long commits = EEPROM.commits;
+	auto start = std::chrono::steady_clock::now();
+
+	for (unsigned int k = 0; k < iterations; k++) {
+		op();
+	}
+
+	auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start).count();
+	allocs = allocations - allocs;
+	commits = EEPROM.commits - commits;
+
+	printf("%s{\"name\":\"%s\",\"iterations\":%u,\"ns_per_op\":%.1f,"
+			"\"allocs_per_op\":%.2f,\"flash_per_op\":%.2f}", first ? "[\n" : ",\n",
+			name, iterations, (double) ns / iterations,
+			(double) allocs / iterations,
+			(double) commits * EEPROM_SIZE / iterations);
+	first = false;
+}
+
+/**
+ * Run all benchmarks and print the results.
+ */
+void HostBench::runAll() {
+	ZoneOutputs idle_outputs;
+	Zone idle { ZONE::COUNT - 1 };
+	idle.pump.attach(&idle_outputs, &m->ontime);
+
+	const unsigned long val = m->refresh.get();
+	const byte set_req[] = { PRM::REFRESH_RATE, (byte) (val >> 24),
+			(byte) (val >> 16), (byte) (val >> 8), (byte) val, PRM::NONE };
+	const byte get_req[] = { PRM::REFRESH_RATE, PRM::NONE };
+
+	bool reset_last_err;
+	uint64_t now = m->clock.update();
+	volatile unsigned long sink = 0;
+	unsigned long saves = 0;
+
+	measure("pump_run", 100000, [&]() {
+		idle.pump.run(now, false, -1UL);
+	});
+
+	measure("parameter_set", 100000, [&]() {
+		m->ontime.set(m->ontime.get());
+	});
+
+	measure("parameter_get", 100000, [&]() {
+		sink = sink + m->ontime.get();
+	});
+
+	// Every save changes the value, so each one commits
+	measure("parameter_eeprom_save", 10000, [&]() {
+		m->ontime.set(++saves & 1);
+		m->ontime.eepromSave();
+	});
+
+	measure("parameter_eeprom_load", 10000, [&]() {
+		idle.flow_capacity.eepromLoad();
+	});
+
+	m->quiet = true;
+	measure("parse_set_request", 100000, [&]() {
+		BufferStream stream(set_req, sizeof(set_req));
+		m->parseParamSetRequest(&stream);
+	});
+
+	measure("parse_get_request", 100000, [&]() {
+		BufferStream stream(get_req, sizeof(get_req));
+		m->parseParamGetRequest(&stream);
+	});
+	m->quiet = false;
+
+	measure("pack_upload", 10000, [&]() {
+		m->refresh.upload = true;
+		m->packFlaggedParams(m->packet, sizeof(m->packet), &reset_last_err);
+	});
+
+	// Its tank is empty, nothing is requested and its day is current
+	idle_machine->uptime_day = idle_machine->clock.localDay();
+	measure("machine_run", 100000, [&]() {
+		HOST::now_ms++;
+		idle_machine->run(idle_machine->clock.update());
+	});
+
+	printf("\n]\n");
+}
+
+static MachineState machine;
+static MachineState idle_machine;
+
+int main() {
+	memset(EEPROM.data, 0, PRM::ID_END * sizeof(unsigned long));
+	machine.begin();
+	idle_machine.begin();
+
+	HostBench(&machine, &idle_machine).runAll();
+	return 0;
+}
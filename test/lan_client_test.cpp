@@ -0,0 +1,83 @@
+/**
+ * Serves local clients whose requests arrive in several TCP segments. A
+ * request is only applied once its ending CMD::NONE has arrived, or when the
+ * client has been silent for WIFI::LAN_IDLE_TIMEOUT.
+ */
+
+#include <EEPROM.h>
+#include "MachineState.h"
+#include "check.h"
+
+static MachineState m;
+static HOST::Peer peer;
+
+static void connect() {
+	peer = HOST::Peer();
+	peer.waiting = true;
+	HOST::lan_peer = &peer;
+}
+
+static void testSplitRequest() {
+	const byte first[] = { CMD::SET, PRM::ONTIME, 0x00, 0x00 };
+	const byte second[] = { 0x00, 0x07, PRM::NONE, CMD::GET, PRM::ONTIME,
+			PRM::NONE };
+	const byte last[] = { CMD::NONE };
+
+	connect();
+	m.ontime.set(5);
+	peer.send(first, sizeof(first));
+	m.serveLocalClient(1000);
+	CHECK_EQ(m.ontime.get(), 5);
+	CHECK(peer.open);
+
+	peer.send(second, sizeof(second));
+	m.serveLocalClient(1100);
+	CHECK_EQ(m.ontime.get(), 5);
+	CHECK(peer.open);
+
+	peer.send(last, sizeof(last));
+	m.serveLocalClient(1200);
+	CHECK_EQ(m.ontime.get(), 7);
+	CHECK(!peer.open);
+
+	// Chip id, CMD::SET and the requested parameter
+	CHECK(peer.tx_len >= 9);
+	CHECK_EQ(peer.tx[3], CMD::SET);
+	CHECK_EQ(peer.tx[4], PRM::ONTIME);
+	CHECK_EQ(peer.tx[8], 7);
+	CHECK_EQ(peer.tx[peer.tx_len - 1], PRM::NONE);
+}
+
+static void testIdleTimeout() {
+	const byte cut[] = { CMD::SET, PRM::ONTIME, 0x00, 0x00, 0x00, 0x09 };
+
+	connect();
+	peer.send(cut, sizeof(cut));
+	m.serveLocalClient(5000);
+	m.serveLocalClient(5000 + WIFI::LAN_IDLE_TIMEOUT);
+	CHECK_EQ(m.ontime.get(), 7);
+	CHECK(peer.open);
+
+	// Applied as far as it goes after the client went silent
+	m.serveLocalClient(5001 + WIFI::LAN_IDLE_TIMEOUT);
+	CHECK_EQ(m.ontime.get(), 9);
+	CHECK(!peer.open);
+	CHECK(peer.tx_len > 0);
+
+	// A client that sends nothing is dropped without a reply
+	connect();
+	m.serveLocalClient(10000);
+	m.serveLocalClient(10001 + WIFI::LAN_IDLE_TIMEOUT);
+	CHECK(!peer.open);
+	CHECK_EQ(peer.tx_len, 0);
+}
+
+int main() {
+	memset(EEPROM.data, 0, PRM::ID_END * sizeof(unsigned long));
+	m.begin();
+
+	testSplitRequest();
+	testIdleTimeout();
+
+	return check_failures;
+}
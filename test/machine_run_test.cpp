@@ -0,0 +1,111 @@
+/**
+ * Checks what MachineState::run() saves to EEPROM during pump runs and that
+ * the measured flow is kept apart from the flow capacity set by the server.
+ */
+
+#include <EEPROM.h>
+#include "TraceReplay.h"
+#include "check.h"
+
+static MachineState m;
+static MachineState flow_machine;
+
+// Tank level in ADC counts, falls 5 counts per second while zone 0 pumps
+static int tank_level = 600;
+
+static int tank(unsigned long) {
+	return tank_level;
+}
+
+// Sets the clock, tank, round time and a zone 0 duty of one half
+static const byte setup_cmds[] = { CMD::SET, //
+		PRM::TIME, 0x65, 0x53, 0xF1, 0x00, // 2023-11-14 22:13:20 UTC
+		PRM::TANK_SIZE, 0x00, 0x01, 0x86, 0xA0, // 100000 cc
+		PRM::ONTIME, 0x00, 0x00, 0x00, 0x05, // 5 s
+		PRM::zoneId(0, PRM::Z_FLOW_CAPACITY), 0x00, 0x00, 0x02, 0x58, // 600 cc/min
+		PRM::zoneId(0, PRM::Z_FLOW_REQUEST), 0x00, 0x06, 0x97, 0x80, // 432000 cc/day
+		PRM::NONE, CMD::NONE };
+
+static void testOneCommitPerRun() {
+	unsigned long commits;
+	unsigned int stops = 0;
+
+	memset(EEPROM.data, 0, PRM::ID_END * sizeof(unsigned long));
+	TraceReplay driver(&m);
+	driver.command(setup_cmds, sizeof(setup_cmds));
+	driver.step(0); // Day of the clock is saved
+	commits = EEPROM.commits;
+
+	for (unsigned long t = 100; t <= 60000; t += 100) {
+		driver.step(t);
+	}
+
+	for (const TraceReplay::Decision& d : driver.actual) {
+		if (!d.on) {
+			++stops;
+		}
+	}
+	CHECK(stops >= 2);
+	CHECK_EQ(EEPROM.commits - commits, stops);
+
+	// Start of the last run is saved with the volumes
+	Parameter saved { PRM::zoneId(0, PRM::Z_LAST_START), 0, -1UL };
+	saved.eepromLoad();
+	CHECK(saved.get() > 0x6553F100UL);
+	CHECK_EQ(saved.get(), m.zones[0].last_start.get());
+
+	Parameter pumped { PRM::zoneId(0, PRM::Z_PUMPED_VOL), 0, -1UL };
+	pumped.eepromLoad();
+	CHECK(pumped.get() > 0);
+	CHECK_EQ(pumped.get(), m.zones[0].pumped_vol.get());
+}
+
+// Level sensor on channel 1, zone 0 runs 25 s rounds
+static const byte flow_cmds[] = { CMD::SET, //
+		PRM::TANK_SIZE, 0x00, 0x01, 0x86, 0xA0, // 100000 cc
+		PRM::ONTIME, 0x00, 0x00, 0x00, 0x19, // 25 s
+		PRM::FLOW_LEVEL_CH, 0x00, 0x00, 0x00, 0x01, //
+		PRM::zoneId(0, PRM::Z_FLOW_CAPACITY), 0x00, 0x00, 0x02, 0x58, // 600 cc/min
+		PRM::zoneId(0, PRM::Z_FLOW_REQUEST), 0x00, 0x0F, 0x42, 0x40, // 1000000 cc/day
+		PRM::NONE, CMD::NONE };
+
+// Server sets the flow capacity again
+static const byte capacity_cmds[] = { CMD::SET, //
+		PRM::zoneId(0, PRM::Z_FLOW_CAPACITY), 0x00, 0x00, 0x02, 0x58, //
+		PRM::NONE, CMD::NONE };
+
+static void testFlowEstimate() {
+	unsigned long estimate;
+
+	memset(EEPROM.data, 0, PRM::ID_END * sizeof(unsigned long));
+	TraceReplay driver(&flow_machine);
+	HOST::analog = tank;
+	driver.command(flow_cmds, sizeof(flow_cmds));
+
+	for (unsigned long t = 0; t <= 120000; t += 100) {
+		if (flow_machine.outputs.get(0) && t % 1000 == 0) {
+			tank_level -= 5;
+		}
+		driver.step(t);
+	}
+
+	estimate = flow_machine.zones[0].flow_estimate.get();
+	CHECK(estimate > 0);
+	CHECK_EQ(flow_machine.pump_fault.get(), 0);
+	CHECK_EQ(flow_machine.zones[0].pump.flow(), estimate);
+
+	Parameter saved { PRM::zoneId(0, PRM::Z_FLOW_ESTIMATE), 0, -1UL };
+	saved.eepromLoad();
+	CHECK_EQ(saved.get(), estimate);
+
+	// The server owns the flow capacity, setting it keeps the estimate
+	driver.command(capacity_cmds, sizeof(capacity_cmds));
+	CHECK_EQ(flow_machine.zones[0].flow_capacity.get(), 600);
+	CHECK_EQ(flow_machine.zones[0].flow_estimate.get(), estimate);
+}
+
+int main() {
+	testOneCommitPerRun();
+	testFlowEstimate();
+	return check_failures;
+}
@@ -0,0 +1,97 @@
+/**
+ * Runs the MQTT session against a broker stand-in. Commands from the command
+ * topic are applied and answered on the parameter topic, a publish leaves
+ * LAST_ERR for the server and reconnects back off while the broker is down.
+ */
+
+#include <EEPROM.h>
+#include "MachineState.h"
+#include "check.h"
+
+static MachineState m;
+static HOST::Broker broker;
+
+// Returns the value of parameter id in the last publish, -1 if not in it
+static long published(prmid_t id) {
+	for (unsigned int k = 4; k + 5 <= broker.payload_len; k += 5) {
+		if (broker.payload[k] == id) {
+			return ((unsigned long) broker.payload[k + 1] << 24)
+					| ((unsigned long) broker.payload[k + 2] << 16)
+					| (broker.payload[k + 3] << 8) | broker.payload[k + 4];
+		}
+	}
+	return -1;
+}
+
+static void testConnect() {
+	broker.up = true;
+	m.serveMqtt(1000);
+	CHECK_EQ(broker.connects, 1);
+	CHECK(strcmp(broker.subscribed, "hw/123456/cmd") == 0);
+
+	// All parameters are published after connecting
+	m.serveMqtt(1001);
+	CHECK_EQ(broker.publishes, 1);
+	CHECK(strcmp(broker.topic, "hw/123456/prm") == 0);
+	CHECK_EQ(published(PRM::ONTIME), 5);
+	CHECK_EQ(broker.payload[3], CMD::SET);
+	CHECK_EQ(broker.payload[broker.payload_len - 1], PRM::NONE);
+
+	// Nothing changed, nothing published
+	m.serveMqtt(3000);
+	CHECK_EQ(broker.publishes, 1);
+}
+
+static void testCommand() {
+	const byte cmds[] = { CMD::SET, PRM::ONTIME, 0x00, 0x00, 0x00, 0x07,
+			PRM::NONE, CMD::GET, PRM::TANK_SIZE, PRM::NONE, CMD::NONE };
+
+	broker.deliver(cmds, sizeof(cmds));
+	m.serveMqtt(3100);
+	CHECK_EQ(m.ontime.get(), 7);
+	CHECK_EQ(broker.publishes, 2);
+	CHECK_EQ(published(PRM::ONTIME), 7);
+	CHECK(published(PRM::TANK_SIZE) >= 0);
+}
+
+static void testLastErrKept() {
+	m.last_err.set(ERR::CONN_ERR);
+	m.serveMqtt(5000);
+	CHECK_EQ(broker.publishes, 3);
+	CHECK_EQ(published(PRM::LAST_ERR), ERR::CONN_ERR);
+	CHECK_EQ(m.last_err.get(), ERR::CONN_ERR);
+}
+
+static void testBackoff() {
+	broker.up = false;
+	broker.connects = 0;
+
+	// Attempts 10 s, 20 s and 40 s apart
+	for (unsigned long t = 10000; t < 90000; t += 100) {
+		m.serveMqtt(t);
+	}
+	CHECK_EQ(broker.connects, 3);
+
+	broker.up = true;
+	for (unsigned long t = 90000; t <= 170000; t += 100) {
+		m.serveMqtt(t);
+	}
+	CHECK_EQ(broker.connects, 4);
+	CHECK_EQ(broker.publishes, 4);
+}
+
+int main() {
+	memset(EEPROM.data, 0, PRM::ID_END * sizeof(unsigned long));
+	HOST::broker = &broker;
+	m.begin();
+	m.ontime.set(5);
+	m.beginMqtt();
+	m.mqtt_enable.set(1);
+
+	testConnect();
+	testCommand();
+	testLastErrKept();
+	testBackoff();
+
+	return check_failures;
+}
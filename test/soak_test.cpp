@@ -0,0 +1,113 @@
+/**
+ * Loops server download and upload, LAN requests and MQTT commands through
+ * the stubs and counts heap allocations with a replaced operator new. After
+ * the first pass no iteration may allocate, the firmware only uses buffers
+ * allocated once.
+ */
+
+#include <EEPROM.h>
+#include <new>
+#include "MachineState.h"
+#include "check.h"
+
+static unsigned long allocations = 0;
+
+void * operator new(size_t size) {
+	++allocations;
+	void * p = malloc(size ? size : 1);
+	if (p == nullptr) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void * operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void * p) noexcept {
+	free(p);
+}
+
+void operator delete[](void * p) noexcept {
+	free(p);
+}
+
+static const unsigned int ITERATIONS = 200;
+
+static MachineState m;
+static HOST::Peer server;
+static HOST::Peer lan;
+static HOST::Broker broker;
+
+// Sets ONTIME to value and requests TANK_SIZE
+static void command(byte * const cmds, byte value) {
+	const byte stream[] = { CMD::SET, PRM::ONTIME, 0x00, 0x00, 0x00, value,
+			PRM::NONE, CMD::GET, PRM::TANK_SIZE, PRM::NONE, CMD::NONE };
+	memcpy(cmds, stream, sizeof(stream));
+}
+
+int main() {
+	byte cmds[11];
+	unsigned long worst = 0;
+	unsigned long first = 0;
+	unsigned int publishes;
+
+	memset(EEPROM.data, 0, PRM::ID_END * sizeof(unsigned long));
+	HOST::remote = &server;
+	HOST::lan_peer = &lan;
+	HOST::broker = &broker;
+	broker.up = true;
+
+	m.begin();
+	m.clock.set(1700000000UL);
+	m.beginMqtt();
+	m.mqtt_enable.set(1);
+	m.serveMqtt(500); // Connects
+
+	for (unsigned int k = 0; k < ITERATIONS; k++) {
+		unsigned long now = 1000 + k * 1000;
+		unsigned long before = allocations;
+		HOST::now_ms = now;
+		publishes = broker.publishes;
+
+		// Server refresh
+		server.rx_len = server.rx_pos = server.tx_len = 0;
+		command(cmds, 1 + k % 50);
+		server.send(cmds, sizeof(cmds));
+		m.downloadFromServer();
+		m.uploadToServer();
+		CHECK_EQ(m.ontime.get(), 1 + k % 50);
+		CHECK(server.tx_len > 4);
+
+		// Local client
+		lan = HOST::Peer();
+		lan.waiting = true;
+		command(cmds, 51 + k % 50);
+		lan.send(cmds, sizeof(cmds));
+		m.serveLocalClient(now);
+		CHECK_EQ(m.ontime.get(), 51 + k % 50);
+		CHECK(lan.tx_len > 4);
+
+		// MQTT command
+		command(cmds, 101 + k % 50);
+		broker.deliver(cmds, sizeof(cmds));
+		m.serveMqtt(now);
+		CHECK_EQ(m.ontime.get(), 101 + k % 50);
+
+		m.run(m.clock.update());
+
+		if (k == 0) {
+			first = allocations - before;
+		} else {
+			CHECK(broker.publishes > publishes);
+			worst = std::max(worst, allocations - before);
+		}
+	}
+
+	CHECK_EQ(worst, 0);
+	printf("allocations: %lu in first pass, at most %lu per iteration after\n",
+			first, worst);
+
+	return check_failures;
+}
@@ -0,0 +1,192 @@
+#ifndef Arduino_h
+#define Arduino_h
+
+/**
+ * Minimal host stand-in for the Arduino core, enough to build the hardware
+ * independent classes. Time and pins are driven by the tests, see stubs.cpp.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <functional>
+#include <string>
+
+typedef uint8_t byte;
+
+using std::min;
+using std::max;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define A0 17
+#define DEC 10
+#define HEX 16
+#define LSBFIRST 0
+#define MSBFIRST 1
+#define ICACHE_RAM_ATTR
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+int analogRead(uint8_t pin);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+void shiftOut(uint8_t data_pin, uint8_t clock_pin, uint8_t bit_order,
+		uint8_t val);
+
+/**
+ * Serial output is dropped.
+ */
+class HardwareSerial {
+public:
+	template<class T> size_t print(T) {
+		return 0;
+	}
+	template<class T> size_t print(T, int) {
+		return 0;
+	}
+	template<class T> size_t println(T) {
+		return 0;
+	}
+	template<class T> size_t println(T, int) {
+		return 0;
+	}
+	size_t println() {
+		return 0;
+	}
+	int available() {
+		return 0;
+	}
+	explicit operator bool() {
+		return true;
+	}
+};
+
+extern HardwareSerial Serial;
+
+/**
+ * Arduino String, only what the sketch uses.
+ */
+class String {
+private:
+	std::string s;
+
+public:
+	String(const char * const cstr = "") :
+			s(cstr ? cstr : "") {
+	}
+	const char * c_str() const {
+		return s.c_str();
+	}
+	bool operator==(const char * const cstr) const {
+		return s == cstr;
+	}
+	bool operator!=(const char * const cstr) const {
+		return s != cstr;
+	}
+};
+
+class Print {
+public:
+	virtual ~Print() {
+	}
+	virtual size_t write(uint8_t b) = 0;
+	virtual size_t write(const uint8_t * buffer, size_t size) {
+		size_t n = 0;
+		while (size--) {
+			n += write(*buffer++);
+		}
+		return n;
+	}
+	virtual void flush() {
+	}
+};
+
+/**
+ * Stream without time, a read that would wait fails at once.
+ */
+class Stream: public Print {
+protected:
+	unsigned long _timeout = 1000;
+
+public:
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int peek() = 0;
+
+	void setTimeout(unsigned long timeout) {
+		_timeout = timeout;
+	}
+	unsigned long getTimeout() const {
+		return _timeout;
+	}
+	size_t readBytes(char * buffer, size_t length) {
+		size_t n = 0;
+		int c;
+		while (n < length && (c = read()) >= 0) {
+			buffer[n++] = (char) c;
+		}
+		return n;
+	}
+	size_t readBytes(uint8_t * buffer, size_t length) {
+		return readBytes((char *) buffer, length);
+	}
+	size_t readBytesUntil(char terminator, char * buffer, size_t length) {
+		size_t n = 0;
+		int c;
+		while (n < length && (c = read()) >= 0 && c != terminator) {
+			buffer[n++] = (char) c;
+		}
+		return n;
+	}
+};
+
+namespace HOST {
+extern unsigned long now_ms;
+extern int (*analog)(unsigned long now_ms);
+extern uint8_t pins[32];	// Last written or input level per pin
+extern uint32_t free_heap;	// Returned by ESP.getFreeHeap()
+}
+
+/**
+ * ESP8266 system calls.
+ */
+class EspClass {
+public:
+	uint32_t getChipId() {
+		return 0x123456;
+	}
+	uint32_t getFreeHeap() {
+		return HOST::free_heap;
+	}
+	uint32_t getMaxFreeBlockSize() {
+		return 30000;
+	}
+	uint8_t getHeapFragmentation() {
+		return 10;
+	}
+	uint32_t getCycleCount() {
+		return micros() * 80;
+	}
+	uint8_t getCpuFreqMHz() {
+		return 80;
+	}
+};
+
+extern EspClass ESP;
+
+void configTime(int timezone, int daylight_offset_sec, const char * server1);
+
+/**
+ * Host time and analogue input, set by the tests.
+ */
+#endif
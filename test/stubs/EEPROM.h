@@ -0,0 +1,47 @@
+#ifndef EEPROM_h
+#define EEPROM_h
+
+#include "Arduino.h"
+
+/**
+ * EEPROM emulation in RAM. Erased bytes read 0xFF as on the device.
+ */
+class EEPROMClass {
+public:
+	uint8_t data[4096];
+	unsigned long commits = 0;	// Number of commit() calls
+
+	EEPROMClass() {
+		memset(data, 0xFF, sizeof(data));
+	}
+
+	void begin(size_t) {
+	}
+
+	uint8_t read(int address) {
+		return data[address];
+	}
+
+	void write(int address, uint8_t val) {
+		data[address] = val;
+	}
+
+	template<class T> T& get(int address, T& t) {
+		memcpy(&t, data + address, sizeof(T));
+		return t;
+	}
+
+	template<class T> const T& put(int address, const T& t) {
+		memcpy(data + address, &t, sizeof(T));
+		return t;
+	}
+
+	bool commit() {
+		++commits;
+		return true;
+	}
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
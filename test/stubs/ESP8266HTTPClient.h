@@ -0,0 +1,80 @@
+#ifndef ESP8266HTTPClient_h
+#define ESP8266HTTPClient_h
+
+#include "ESP8266WiFi.h"
+
+#define HTTP_CODE_OK 200
+#define HTTPC_ERROR_CONNECTION_FAILED (-1)
+
+namespace HOST {
+extern int http_code;	// Status of every request
+extern const char * http_date;	// Date header of every response
+}
+
+/**
+ * Host stand-in for the HTTP client. Like the real client a request only
+ * reuses a connection it opened itself, otherwise it reconnects the client
+ * given to begin(). The response body
+ * is what the test put in the rx of HOST::remote, POSTed data ends up in its
+ * tx. The connection is kept by end() when reused.
+ */
+class HTTPClient {
+public:
+	void setReuse(bool keep) {
+		reuse = keep;
+	}
+	void setTimeout(uint16_t) {
+	}
+	bool begin(WiFiClient & transport, const char *) {
+		can_reuse = can_reuse && client == &transport;
+		client = &transport;
+		return true;
+	}
+	void collectHeaders(const char * [], const size_t count) {
+		collect = count > 0;
+	}
+	int GET() {
+		return request();
+	}
+	int POST(uint8_t * payload, size_t size) {
+		int code = request();
+		if (code > 0) {
+			client->write(payload, size);
+		}
+		return code;
+	}
+	WiFiClient * getStreamPtr() {
+		return client;
+	}
+	String header(const char *) {
+		return String(collect ? HOST::http_date : "");
+	}
+	void end() {
+		if (client != nullptr && !reuse) {
+			client->stop();
+		}
+	}
+
+private:
+	WiFiClient * client = nullptr;
+	bool reuse = false;
+	bool can_reuse = false;	// Connection opened by a previous request
+	bool collect = false;
+
+	int request() {
+		if (client == nullptr) {
+			return HTTPC_ERROR_CONNECTION_FAILED;
+		}
+		if (!can_reuse || !client->connected()) {
+			client->stop();
+			if (!client->connect("server", 0)) {
+				can_reuse = false;
+				return HTTPC_ERROR_CONNECTION_FAILED;
+			}
+		}
+		can_reuse = reuse;
+		return HOST::http_code;
+	}
+};
+
+#endif
@@ -0,0 +1,178 @@
+#ifndef ESP8266WiFi_h
+#define ESP8266WiFi_h
+
+/**
+ * Host stand-in for the ESP8266 WiFi library. The station is connected as set
+ * by HOST::wifi_connected. There is no network, a client connects to the
+ * HOST::Peer a test sets as HOST::remote, and WiFiServer::available() hands
+ * out HOST::lan_peer.
+ */
+
+#include "Arduino.h"
+
+#define WL_CONNECTED 3
+#define WL_DISCONNECTED 6
+#define WIFI_STA 1
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED (-2)
+
+namespace HOST {
+extern bool wifi_connected;
+
+/**
+ * Remote end of a connection. The test appends to rx what the board shall
+ * receive, e.g. one TCP segment at a time, and finds what it sent in tx.
+ */
+struct Peer {
+	uint8_t rx[1024];
+	size_t rx_len = 0;
+	size_t rx_pos = 0;
+	uint8_t tx[1024];
+	size_t tx_len = 0;
+	bool waiting = false;	// Accepted by the next WiFiServer::available()
+	bool open = false;
+	unsigned int connects = 0;	// Connections opened to this peer
+
+	void send(const uint8_t * data, size_t len) {
+		while (len-- && rx_len < sizeof(rx)) {
+			rx[rx_len++] = *data++;
+		}
+	}
+};
+
+extern Peer * lan_peer;	// Client of the WiFiServer, may be nullptr
+extern Peer * remote;	// Server clients connect to, may be nullptr
+}
+
+class WiFiClient: public Stream {
+public:
+	WiFiClient() :
+			peer(nullptr) {
+	}
+	explicit WiFiClient(HOST::Peer * const remote) :
+			peer(remote) {
+	}
+	virtual ~WiFiClient() {
+	}
+	virtual int connect(const char *, uint16_t) {
+		if (HOST::remote == nullptr) {
+			return 0;
+		}
+		peer = HOST::remote;
+		peer->open = true;
+		++peer->connects;
+		return 1;
+	}
+	virtual uint8_t connected() {
+		return peer != nullptr && peer->open;
+	}
+	virtual void stop() {
+		if (peer != nullptr) {
+			peer->open = false;
+			peer = nullptr;
+		}
+	}
+	int available() override {
+		return peer ? peer->rx_len - peer->rx_pos : 0;
+	}
+	int read() override {
+		return available() ? peer->rx[peer->rx_pos++] : -1;
+	}
+	int read(uint8_t * buffer, size_t length) {
+		size_t n = 0;
+		while (n < length && available()) {
+			buffer[n++] = peer->rx[peer->rx_pos++];
+		}
+		return n;
+	}
+	int peek() override {
+		return available() ? peer->rx[peer->rx_pos] : -1;
+	}
+	size_t write(uint8_t b) override {
+		if (peer == nullptr || peer->tx_len >= sizeof(peer->tx)) {
+			return 0;
+		}
+		peer->tx[peer->tx_len++] = b;
+		return 1;
+	}
+	using Print::write;
+	explicit operator bool() {
+		return peer != nullptr;
+	}
+
+protected:
+	HOST::Peer * peer;
+};
+
+class WiFiServer {
+public:
+	WiFiServer(uint16_t) {
+	}
+	void begin() {
+	}
+	void setNoDelay(bool) {
+	}
+	WiFiClient available() {
+		if (HOST::lan_peer == nullptr || !HOST::lan_peer->waiting) {
+			return WiFiClient();
+		}
+		HOST::lan_peer->waiting = false;
+		HOST::lan_peer->open = true;
+		return WiFiClient(HOST::lan_peer);
+	}
+};
+
+class ESP8266WiFiClass {
+public:
+	void persistent(bool) {
+	}
+	bool mode(int) {
+		return true;
+	}
+	int begin(const char *, const char *, int32_t = 0,
+			const uint8_t * = nullptr) {
+		return status();
+	}
+	bool disconnect() {
+		return true;
+	}
+	int status() {
+		return HOST::wifi_connected ? WL_CONNECTED : WL_DISCONNECTED;
+	}
+	int32_t RSSI() {
+		return -60;
+	}
+	int32_t RSSI(uint8_t) {
+		return -60;
+	}
+	uint8_t * BSSID() {
+		return bssid;
+	}
+	uint8_t * BSSID(uint8_t) {
+		return bssid;
+	}
+	int32_t channel() {
+		return 1;
+	}
+	int32_t channel(uint8_t) {
+		return 1;
+	}
+	String SSID(uint8_t) {
+		return String();
+	}
+	int8_t scanNetworks(bool = false) {
+		return WIFI_SCAN_FAILED;
+	}
+	int8_t scanComplete() {
+		return WIFI_SCAN_FAILED;
+	}
+	void scanDelete() {
+	}
+
+private:
+	uint8_t bssid[6] = { };
+};
+
+extern ESP8266WiFiClass WiFi;
+
+#endif
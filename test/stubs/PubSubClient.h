@@ -0,0 +1,111 @@
+#ifndef PubSubClient_h
+#define PubSubClient_h
+
+#include "ESP8266WiFi.h"
+
+namespace HOST {
+
+/**
+ * Broker stand-in. A message put in the inbox is delivered to the callback at
+ * the next loop(), the last publish is kept.
+ */
+struct Broker {
+	bool up = false;	// Accepts and keeps connections
+	unsigned int connects = 0;	// Connection attempts
+	unsigned int publishes = 0;
+	char subscribed[32] = { };
+	uint8_t inbox[512];
+	unsigned int inbox_len = 0;
+	char topic[32] = { };	// Topic of last publish
+	uint8_t payload[1024];	// Payload of last publish
+	unsigned int payload_len = 0;
+
+	void deliver(const uint8_t * data, unsigned int len) {
+		inbox_len = 0;
+		while (len-- && inbox_len < sizeof(inbox)) {
+			inbox[inbox_len++] = *data++;
+		}
+	}
+};
+
+extern Broker * broker;	// May be nullptr, then nothing connects
+}
+
+/**
+ * Host stand-in for the MQTT client, connected to HOST::broker if it is up.
+ */
+class PubSubClient {
+public:
+	typedef std::function<void(char *, uint8_t *, unsigned int)> Callback;
+
+	PubSubClient(WiFiClient &) {
+	}
+	bool setBufferSize(uint16_t) {
+		return true;
+	}
+	PubSubClient& setCallback(Callback cb) {
+		callback = cb;
+		return *this;
+	}
+	PubSubClient& setServer(const char *, uint16_t) {
+		return *this;
+	}
+	PubSubClient& setSocketTimeout(uint16_t) {
+		return *this;
+	}
+	bool connect(const char *, const char *, const char *, const char *,
+			uint8_t, bool, const char *, bool) {
+		if (HOST::broker == nullptr) {
+			return false;
+		}
+		++HOST::broker->connects;
+		is_connected = HOST::broker->up;
+		return is_connected;
+	}
+	bool connected() {
+		is_connected = is_connected && HOST::broker && HOST::broker->up;
+		return is_connected;
+	}
+	void disconnect() {
+		is_connected = false;
+	}
+	bool loop() {
+		if (!connected()) {
+			return false;
+		}
+		if (HOST::broker->inbox_len > 0 && callback) {
+			unsigned int len = HOST::broker->inbox_len;
+			HOST::broker->inbox_len = 0;
+			callback(HOST::broker->subscribed, HOST::broker->inbox, len);
+		}
+		return true;
+	}
+	bool publish(const char * topic, const uint8_t * payload,
+			unsigned int length) {
+		if (!connected() || length > sizeof(HOST::broker->payload)) {
+			return false;
+		}
+		++HOST::broker->publishes;
+		strncpy(HOST::broker->topic, topic, sizeof(HOST::broker->topic) - 1);
+		memcpy(HOST::broker->payload, payload, length);
+		HOST::broker->payload_len = length;
+		return true;
+	}
+	bool subscribe(const char * topic, uint8_t) {
+		if (!connected()) {
+			return false;
+		}
+		strncpy(HOST::broker->subscribed, topic,
+				sizeof(HOST::broker->subscribed) - 1);
+		return true;
+	}
+	int state() {
+		return is_connected ? 0 : -2;
+	}
+
+private:
+	Callback callback;
+	bool is_connected = false;
+};
+
+#endif
@@ -0,0 +1,64 @@
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "ESP8266HTTPClient.h"
+#include "ESP8266WiFi.h"
+#include "PubSubClient.h"
+#include "WiFiClientSecureBearSSL.h"
+
+HardwareSerial Serial;
+EEPROMClass EEPROM;
+EspClass ESP;
+ESP8266WiFiClass WiFi;
+
+namespace HOST {
+unsigned long now_ms = 0;
+int (*analog)(unsigned long now_ms) = nullptr;
+uint8_t pins[32] = { };
+bool wifi_connected = true;
+uint32_t free_heap = 40000;
+Peer * lan_peer = nullptr;
+Peer * remote = nullptr;
+unsigned int tls_handshakes = 0;
+Broker * broker = nullptr;
+int http_code = HTTP_CODE_OK;
+const char * http_date = "";
+}
+
+unsigned long millis() {
+	return HOST::now_ms;
+}
+
+unsigned long micros() {
+	return HOST::now_ms * 1000;
+}
+
+void delay(unsigned long ms) {
+	HOST::now_ms += ms;
+}
+
+void delayMicroseconds(unsigned int) {
+}
+
+void yield() {
+}
+
+int analogRead(uint8_t) {
+	return HOST::analog ? HOST::analog(HOST::now_ms) : 0;
+}
+
+void pinMode(uint8_t, uint8_t) {
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+	HOST::pins[pin & 31] = val;
+}
+
+int digitalRead(uint8_t pin) {
+	return HOST::pins[pin & 31];
+}
+
+void shiftOut(uint8_t, uint8_t, uint8_t, uint8_t) {
+}
+
+void configTime(int, int, const char *) {
+}
@@ -0,0 +1,64 @@
+/**
+ * Runs server requests over a TLS stand-in, built with WIFI_USE_TLS. The
+ * request opens the connection, so each connection costs one handshake and
+ * TLS_HANDSHAKE and TLS_HEAP describe the connection in use.
+ */
+
+#include <EEPROM.h>
+#include "MachineState.h"
+#include "check.h"
+
+static MachineState m;
+static HOST::Peer server;
+
+static void testOneHandshake() {
+	uint32_t heap = HOST::free_heap;
+
+	m.downloadFromServer();
+	m.uploadToServer();
+	CHECK_EQ(server.connects, 1);
+	CHECK(server.open);
+	CHECK_EQ(HOST::tls_handshakes, 1);
+	CHECK_EQ(m.tls_handshake.get(),
+			BearSSL::WiFiClientSecure::HANDSHAKE_MS);
+	CHECK_EQ(m.tls_heap.get(), BearSSL::WiFiClientSecure::HEAP);
+	CHECK_EQ(heap - HOST::free_heap, BearSSL::WiFiClientSecure::HEAP);
+
+	// Kept open, the next refresh has no handshake
+	m.tls_handshake.set(0);
+	m.downloadFromServer();
+	CHECK_EQ(HOST::tls_handshakes, 1);
+	CHECK_EQ(m.tls_handshake.get(), 0);
+}
+
+static void testReconnect() {
+	// Server closed the connection
+	server.open = false;
+	m.downloadFromServer();
+	CHECK_EQ(server.connects, 2);
+	CHECK_EQ(HOST::tls_handshakes, 2);
+	CHECK_EQ(m.tls_handshake.get(),
+			BearSSL::WiFiClientSecure::HANDSHAKE_MS);
+}
+
+static void testConnectFails() {
+	server.open = false;
+	HOST::remote = nullptr;
+	m.last_err.set(ERR::NOERR);
+	m.downloadFromServer();
+	CHECK_EQ(m.last_err.get(), ERR::CONN_ERR);
+	CHECK_EQ(HOST::tls_handshakes, 3);
+}
+
+int main() {
+	memset(EEPROM.data, 0, PRM::ID_END * sizeof(unsigned long));
+	HOST::remote = &server;
+	m.begin();
+	m.beginTls();
+
+	testOneHandshake();
+	testReconnect();
+	testConnectFails();
+
+	return check_failures;
+}
@@ -0,0 +1,72 @@
+/**
+ * Replay an input trace uploaded by the board and compare pump decisions.
+ *
+ *   trace_replay [-d] [-s step_ms] [-t tolerance_ms] trace.bin
+ *
+ * -d prints the decoded records. Exits with 1 if decisions differ.
+ */
+
+#include <unistd.h>
+#include "TraceReplay.h"
+
+static MachineState M;
+
+int main(int argc, char * argv[]) {
+	bool dump = false;
+	unsigned long step_ms = 100;
+	unsigned long tolerance_ms = 1000;
+	std::vector<byte> trace;
+	std::vector<TraceReplay::Record> records;
+	int opt;
+	int c;
+
+	while ((opt = getopt(argc, argv, "ds:t:")) != -1) {
+		switch (opt) {
+		case 'd':
+			dump = true;
+			break;
+		case 's':
+			step_ms = strtoul(optarg, nullptr, 0);
+			break;
+		case 't':
+			tolerance_ms = strtoul(optarg, nullptr, 0);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-d] [-s step_ms] [-t tolerance_ms] "
+					"trace.bin\n", argv[0]);
+			return 2;
+		}
+	}
+	if (optind >= argc || step_ms == 0) {
+		fprintf(stderr, "usage: %s [-d] [-s step_ms] [-t tolerance_ms] "
+				"trace.bin\n", argv[0]);
+		return 2;
+	}
+
+	FILE * in = fopen(argv[optind], "rb");
+	if (in == nullptr) {
+		perror(argv[optind]);
+		return 2;
+	}
+	while ((c = fgetc(in)) != EOF) {
+		trace.push_back(c);
+	}
+	fclose(in);
+
+	if (!TraceReplay::decode(trace.data(), trace.size(), &records)) {
+		fprintf(stderr, "Trace is truncated or corrupt after %zu records\n",
+				records.size());
+	}
+	if (dump) {
+		for (const TraceReplay::Record& rec : records) {
+			TraceReplay::print(rec, stdout);
+		}
+	}
+
+	TraceReplay replay(&M);
+	replay.run(records, step_ms);
+	unsigned int differences = replay.diff(tolerance_ms, stdout);
+	printf("%zu records, %zu pump decisions, %u differences\n",
+			records.size(), replay.expected.size(), differences);
+	return differences ? 1 : 0;
+}
@@ -0,0 +1,112 @@
+/**
+ * Records a trace from scripted inputs, including malformed commands, and
+ * checks that replaying it makes the same pump decisions. Zone 1 waters
+ * in a window, which needs the recorded clock.
+ */
+
+#include <EEPROM.h>
+#include "TraceReplay.h"
+#include "check.h"
+
+static MachineState recorded;
+static MachineState replayed;
+static byte eeprom_start[sizeof(EEPROM.data)];
+
+// Sets tank, round time and zone flows, then requests two parameters
+static const byte setup_cmds[] = { CMD::SET, //
+		PRM::TANK_SIZE, 0x00, 0x01, 0x86, 0xA0, // 100000 cc
+		PRM::ONTIME, 0x00, 0x00, 0x00, 0x05, // 5 s
+		PRM::zoneId(0, PRM::Z_FLOW_CAPACITY), 0x00, 0x00, 0x02, 0x58, // 600 cc/min
+		PRM::zoneId(1, PRM::Z_FLOW_CAPACITY), 0x00, 0x00, 0x02, 0x58, //
+		PRM::zoneId(1, PRM::Z_FLOW_REQUEST), 0x00, 0x06, 0x97, 0x80, // 432000 cc/day
+		PRM::zoneId(1, PRM::Z_WINDOW_START), 0x00, 0x00, 0x05, 0x28, // 22:00
+		PRM::zoneId(1, PRM::Z_WINDOW_END), 0x00, 0x00, 0x05, 0x36, // 22:14
+		PRM::NONE, CMD::GET, PRM::TANK_SIZE, PRM::ONTIME, PRM::NONE, CMD::NONE };
+
+// Unknown command, must be recorded anyway
+static const byte bad_cmds[] = { CMD::SET, PRM::ONTIME, 0x00, 0x00, 0x00, 0x07,
+		PRM::NONE, 0x7F, 0x7E };
+
+// 2023-11-14 22:13:20 UTC, the window of zone 1 closes 40 s later
+static const unsigned long SNTP_TIME = 1700000000UL;
+
+static void press(bool down) {
+	HOST::pins[PINS::SYNC] = down ? LOW : HIGH;
+	recorded.sync.onEdge();
+}
+
+int main() {
+	std::vector<TraceReplay::Record> records;
+	unsigned int pumps = 0;
+	bool primed = false;
+	bool bad_kept = false;
+	bool clock_kept = false;
+
+	// Initialized parameters
+	memset(EEPROM.data, 0, PRM::ID_END * sizeof(unsigned long));
+	memcpy(eeprom_start, EEPROM.data, sizeof(eeprom_start));
+
+	TraceReplay driver(&recorded);
+	recorded.trace.record(TRC::BOOT);
+
+	for (unsigned long t = 0; t <= 120000; t += 100) {
+		HOST::now_ms = t;
+		if (t == 500) {
+			recorded.clock.set(SNTP_TIME); // As by SNTP, not a command
+		} else if (t == 1000) {
+			driver.command(setup_cmds, sizeof(setup_cmds));
+		} else if (t == 3000) {
+			driver.command(bad_cmds, sizeof(bad_cmds));
+		} else if (t == 24000) {
+			press(true);
+		} else if (t == 27000) {
+			press(false);
+		}
+		driver.step(t);
+	}
+
+	const byte * trace = recorded.trace.linearize();
+	CHECK(TraceReplay::decode(trace, recorded.trace.size(), &records));
+	for (const TraceReplay::Record& rec : records) {
+		if (rec.type == TRC::PUMP) {
+			++pumps;
+			primed |= (rec.payload[0] == 1); // Zone 0 on
+		}
+		clock_kept |= (rec.type == TRC::CLOCK);
+		if (rec.type == TRC::RX) {
+			for (byte b : rec.payload) {
+				bad_kept |= (b == 0x7F);
+			}
+		}
+	}
+	CHECK(pumps >= 4);
+	CHECK_EQ(driver.actual.size(), pumps);
+	CHECK(primed);
+	CHECK(bad_kept);
+	CHECK(clock_kept);
+
+	memcpy(EEPROM.data, eeprom_start, sizeof(eeprom_start));
+	TraceReplay replay(&replayed);
+	replay.run(records, 100);
+	CHECK_EQ(replay.expected.size(), pumps);
+	CHECK_EQ(replay.diff(200, stdout), 0);
+	CHECK_EQ(replayed.ontime.get(), 7);
+	CHECK_EQ(replayed.clock.epoch(), SNTP_TIME + (HOST::now_ms - 500) / 1000);
+
+	// Without the clock record zone 1 would water outside its window
+	std::vector<TraceReplay::Record> unsynced;
+	for (const TraceReplay::Record& rec : records) {
+		if (rec.type != TRC::CLOCK) {
+			unsynced.push_back(rec);
+		}
+	}
+	static MachineState unsynced_machine;
+	memcpy(EEPROM.data, eeprom_start, sizeof(eeprom_start));
+	TraceReplay unsynced_replay(&unsynced_machine);
+	unsynced_replay.run(unsynced, 100);
+	FILE * discard = fopen("/dev/null", "w");
+	CHECK(unsynced_replay.diff(200, discard) > 0);
+	fclose(discard);
+
+	return check_failures;
+}
@@ -0,0 +1,66 @@
+/**
+ * Provisions networks through WifiConfig::provision() and reads them back
+ * from EEPROM. SSIDs in quotes and passwords may hold spaces.
+ */
+
+#include <EEPROM.h>
+#include "WifiConfig.h"
+#include "check.h"
+
+// Layout of WifiConfig::Store in EEPROM
+struct Network {
+	char ssid[33];
+	char password[65];
+	uint8_t channel;
+	uint8_t bssid[6];
+};
+
+struct Store {
+	uint8_t magic;
+	int8_t last;
+	char host[48];
+	Network networks[WifiConfig::MAX_NETWORKS];
+};
+
+static WifiConfig wifi;
+
+static const Network& provision(const char * const text, byte slot) {
+	static Store store;
+	char line[160];
+
+	strncpy(line, text, sizeof(line) - 1);
+	line[sizeof(line) - 1] = '\0';
+	CHECK(wifi.provision(line));
+	EEPROM.get(EEPROM_WIFI_POS, store);
+	return store.networks[slot];
+}
+
+int main() {
+	wifi.load();
+
+	const Network& plain = provision("wifi 1 MySsid MyPassword\r", 1);
+	CHECK(strcmp(plain.ssid, "MySsid") == 0);
+	CHECK(strcmp(plain.password, "MyPassword") == 0);
+
+	const Network& spaced = provision("wifi 2 \"My Home\" my secret pw\r", 2);
+	CHECK(strcmp(spaced.ssid, "My Home") == 0);
+	CHECK(strcmp(spaced.password, "my secret pw") == 0);
+
+	const Network& rest = provision("wifi 3 Cafe  two spaces", 3);
+	CHECK(strcmp(rest.ssid, "Cafe") == 0);
+	CHECK(strcmp(rest.password, " two spaces") == 0);
+
+	const Network& open = provision("wifi 0 \"Open Net\"", 0);
+	CHECK(strcmp(open.ssid, "Open Net") == 0);
+	CHECK(strcmp(open.password, "") == 0);
+
+	const Network& cleared = provision("wifi 1\r", 1);
+	CHECK(strcmp(cleared.ssid, "") == 0);
+
+	// Unterminated quote keeps the slot
+	provision("wifi 2 \"Broken", 2);
+	const Network& kept = provision("host example.org", 2);
+	CHECK(strcmp(kept.ssid, "My Home") == 0);
+
+	return check_failures;
+}
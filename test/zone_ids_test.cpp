@@ -0,0 +1,62 @@
+/**
+ * Checks that the pump ids from before zones still reach zones 0 to 2 and that
+ * an update keeps the saved pumped volumes and initializes new EEPROM slots.
+ */
+
+#include <EEPROM.h>
+#include "BufferStream.h"
+#include "MachineState.h"
+#include "check.h"
+
+static MachineState m;
+
+static void testMigration() {
+	// EEPROM as left by the firmware with three pumps
+	for (byte k = 0; k < PRM::LEGACY_ZONES; k++) {
+		Parameter old { (prmid_t) (PRM::P1_PUMPED_VOL + k), 0, -1UL };
+		old.set(1000 * (k + 1));
+		old.eepromSave();
+	}
+
+	m.begin();
+	for (byte k = 0; k < ZONE::COUNT; k++) {
+		CHECK_EQ(m.zones[k].pumped_vol.get(), 1000 * (k + 1));
+		CHECK_EQ(m.zones[k].pumped_today.get(), 0);
+		CHECK_EQ(m.zones[k].last_start.get(), 0);
+		CHECK(!m.zones[k].pumped_vol.eepromErased());
+		CHECK(!m.zones[k].pumped_today.eepromErased());
+		CHECK(!m.zones[k].last_start.eepromErased());
+	}
+	CHECK(!m.budget_day.eepromErased());
+
+	// Saved values win over the old slots from now on
+	m.zones[0].pumped_vol.set(5);
+	m.zones[0].pumped_vol.eepromSave();
+	m.begin();
+	CHECK_EQ(m.zones[0].pumped_vol.get(), 5);
+}
+
+static void testAliases() {
+	const byte set[] = { //
+			PRM::P2_FLOW_CAPACITY, 0x00, 0x00, 0x01, 0x2C, //
+			PRM::P3_FLOW_REQUEST, 0x00, 0x00, 0x10, 0x00, //
+			PRM::zoneId(0, PRM::Z_FLOW_CAPACITY), 0x00, 0x00, 0x00, 0x64, //
+			PRM::NONE };
+	const byte get[] = { PRM::P1_PUMPED_VOL, PRM::NONE };
+	BufferStream set_stream(set, sizeof(set));
+	BufferStream get_stream(get, sizeof(get));
+
+	CHECK(m.parseParamSetRequest(&set_stream));
+	CHECK_EQ(m.zones[1].flow_capacity.get(), 300);
+	CHECK_EQ(m.zones[2].flow_request.get(), 4096);
+	CHECK_EQ(m.zones[0].flow_capacity.get(), 100);
+
+	CHECK(m.parseParamGetRequest(&get_stream));
+	CHECK(m.zones[0].pumped_vol.upload);
+}
+
+int main() {
+	testMigration();
+	testAliases();
+	return check_failures;
+}
@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""Latency and throughput benchmark of the local control port.
+
+Sends CMD::GET requests for a list of parameters to a board (or anything
+serving the same protocol) on TCP port 8266 and times each round trip from
+connect to the closed reply. Prints a JSON summary.
+
+    tools/lan_bench.py 192.168.1.42 -n 200 -p 0x0A 0x0B
+"""
+
+import argparse
+import json
+import socket
+import statistics
+import time
+
+CMD_NONE = 0x00
+CMD_GET = 0x01
+CMD_SET = 0x02
+PRM_NONE = 0x00
+
+
+def request(prm_ids):
+    """Returns a GET request stream for the parameter ids."""
+    return bytes([CMD_GET] + prm_ids + [PRM_NONE, CMD_NONE])
+
+
+def decode_reply(reply):
+    """Returns {prm_id: value} of an upload stream, raises ValueError."""
+    if len(reply) < 5 or reply[3] != CMD_SET or reply[-1] != PRM_NONE:
+        raise ValueError("bad reply %s" % reply.hex())
+    records = reply[4:-1]
+    if len(records) % 5:
+        raise ValueError("truncated reply %s" % reply.hex())
+    return {records[k]: int.from_bytes(records[k + 1:k + 5], "big")
+            for k in range(0, len(records), 5)}
+
+
+def round_trip(host, port, req, timeout):
+    """Returns (seconds, reply) of one request."""
+    start = time.perf_counter()
+    with socket.create_connection((host, port), timeout=timeout) as sock:
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        sock.sendall(req)
+        chunks = []
+        while True:
+            chunk = sock.recv(1024)
+            if not chunk:
+                break
+            chunks.append(chunk)
+    return time.perf_counter() - start, b"".join(chunks)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("host")
+    parser.add_argument("--port", type=int, default=8266)
+    parser.add_argument("-n", "--count", type=int, default=100)
+    parser.add_argument("-p", "--prm", type=lambda v: int(v, 0), nargs="+",
+                        default=[0x0A, 0x0B, 0x0C])
+    parser.add_argument("--timeout", type=float, default=2.0)
+    args = parser.parse_args()
+
+    req = request(args.prm)
+    times = []
+    errors = 0
+    rx_bytes = 0
+    start = time.perf_counter()
+    for _ in range(args.count):
+        try:
+            dt, reply = round_trip(args.host, args.port, req, args.timeout)
+            decode_reply(reply)
+        except (OSError, ValueError):
+            errors += 1
+            continue
+        times.append(dt * 1000)
+        rx_bytes += len(reply)
+    total = time.perf_counter() - start
+
+    times.sort()
+    result = {"requests": args.count, "errors": errors}
+    if times:
+        result.update({
+            "mean_ms": round(statistics.mean(times), 2),
+            "p50_ms": round(times[len(times) // 2], 2),
+            "p95_ms": round(times[min(len(times) - 1, int(len(times) * 0.95))], 2),
+            "max_ms": round(times[-1], 2),
+            "requests_per_s": round(len(times) / total, 1),
+            "reply_bytes_per_s": round(rx_bytes / total),
+        })
+    print(json.dumps(result))
+
+
+if __name__ == "__main__":
+    main()